@@ -0,0 +1,34 @@
+#ifndef AdvancedCanvas_DEFINED
+#define AdvancedCanvas_DEFINED
+
+#include "GCanvas.h"
+#include "GBitmap.h"
+#include "GRect.h"
+
+/**
+ * Returns a canvas that draws into device but only writes the pixels inside clip. Pixels inside the
+ * clip are identical to what GCreateCanvas would produce for the same draws.
+ */
+std::unique_ptr<GCanvas> GCreateClippedCanvas(const GBitmap& device, const GIRect& clip);
+
+/**
+ * Returns a canvas that splits each large draw into horizontal bands and rasterizes them on up to
+ * threadCount threads. The result is identical to what GCreateCanvas would produce.
+ */
+std::unique_ptr<GCanvas> GCreateBandedCanvas(const GBitmap& device, int threadCount);
+
+/**
+ * How many draws every canvas has simplified because of their source's opacity, since the last
+ * GResetBlendReductionStats(). A draw replayed into several tiles counts once per tile.
+ */
+struct GBlendReductionStats {
+    long reducedToSrc;   // SrcOver with an opaque source
+    long reducedToClear; // modes whose result is 0 for a transparent color
+    long elided;         // kDst, or a transparent color that leaves the destination alone
+    long solidStores;    // Src or Clear with a color, filled without reading the destination
+};
+
+GBlendReductionStats GGetBlendReductionStats();
+void GResetBlendReductionStats();
+
+#endif
@@ -1,8 +1,13 @@
 #include "GColor.h"
 #include "GPoint.h"
+#include "MipMap.h"
 
 std::unique_ptr<GShader> GCreateTriBitmapShader(GPoint triPoints[], GPoint texPoints[], GShader* shader);
 
+/**
+ * @brief Creates a shader that blends the three colors across the triangle. The colors must
+ * already be premultiplied by their alpha.
+ */
 std::unique_ptr<GShader> GCreateTriColorShader(GPoint points[], GColor color[]);
 
 std::unique_ptr<GShader> GCreateComposedShader(GShader* sh1, GShader* sh2);
@@ -11,4 +16,11 @@ std::unique_ptr<GShader> GCreateRadialGradient(GPoint p0, GPoint p1, const GColo
 
 std::unique_ptr<GShader> GCreateRayGradient(GPoint p0, GPoint p1, const GColor color[] , int count, GShader::TileMode tileMode);
 
-std::unique_ptr<GShader> GCreateFinalRadialGradient(GPoint center, float radius, const GColor color[] , int count, GShader::TileMode tileMode);
\ No newline at end of file
+std::unique_ptr<GShader> GCreateFinalRadialGradient(GPoint center, float radius, const GColor color[] , int count, GShader::TileMode tileMode);
+
+/**
+ * @brief Creates a bitmap shader that blends the four bitmap pixels nearest each sample rather
+ * than taking the one it lands in, picking mip levels to sample by mipMode.
+ */
+std::unique_ptr<GShader> GCreateBilerpShader(const GBitmap& bitmap, const GMatrix& localMatrix, GShader::TileMode tileMode,
+                                             MipMap::Mode mipMode);
\ No newline at end of file
@@ -8,57 +8,144 @@
 #include "GRect.h"
 #include "GColor.h"
 #include "GBitmap.h"
-#include "BlendUtil.h"
+#include "BlendSpans.h"
 #include "EdgeBuilder.h"
 #include "Edge.h"
+#include "CoverageRasterizer.h"
 #include "GMatrix.h"
 #include <stack>
 #include "GShader.h"
 #include "GPath.h"
 #include <functional>
 #include "AdvancedShaders.h"
+#include "AdvancedCanvas.h"
+#include "ThreadPool.h"
+#include "ScratchArena.h"
+#include "TriangleRasterizer.h"
+#include "MeshVertexCache.h"
+#include "TriColorShader.h"
+#include "TriBitmapShader.h"
+#include "ComposedShader.h"
+#include "Blitter.h"
+#include <new>
+#include <atomic>
 #include "Debug.h"
 
+// How often draws were simplified by their source's opacity. See GGetBlendReductionStats().
+static std::atomic<long> gReducedToSrc(0);
+static std::atomic<long> gReducedToClear(0);
+static std::atomic<long> gElidedDraws(0);
+static std::atomic<long> gSolidStores(0);
+
 class BasicCanvas : public GCanvas {
 public:
-    BasicCanvas(const GBitmap& device)
-        : fDevice(device), eBuilder(0,0,fDevice.width()-1, fDevice.height()-1) {
-            transformationStack.push(*new GMatrix());
+    BasicCanvas(const GBitmap& device, int bandThreads = 1)
+        : BasicCanvas(device, GIRect::MakeWH(device.width(), device.height()), bandThreads) {
     }
-    
 
-    void blit(const int left, const int right, int y, BlendFunction blendFunction, GShader* shader) {
-        
-        //debug("start");
-        int count = right - left;
+    /**
+     * @brief Creates a canvas that only ever touches the pixels inside clip. Geometry is still built
+     * against the whole device, so every pixel inside the clip comes out exactly as it would on an
+     * unclipped canvas.
+     * 
+     * @param bandThreads how many threads a single large draw may be split across.
+     */
+    BasicCanvas(const GBitmap& device, const GIRect& clip, int bandThreads = 1)
+        : fDevice(device), eBuilder(0,0,fDevice.width(), fDevice.height()),
+          coverageRasterizer(fDevice.width(), fDevice.height()), clip(clip),
+          bandThreads(std::max(bandThreads, 1)) {
+            transformationStack.push(GMatrix());
+    }
 
-        if (count < 1) {
-            return;
+    /**
+     * @brief Trims the span [left, right) on row y to the clip.
+     * 
+     * @return true if anything is left to draw.
+     */
+    bool clipSpan(int& left, int& right, int y) const {
+        if (y < clip.top() || y >= clip.bottom()) {
+            return false;
         }
-        
-        
+        left = std::max(left, clip.left());
+        right = std::min(right, clip.right());
+        return left < right;
+    }
 
-        GPixel newPixels[count];
-        // debug( left, y,"{","}");
-        // debug( count, 0,"{","}");
-        // debug(fDevice.width(), fDevice.height(), "[", "]");
-        
-         shader->shadeRow(left, y, count, newPixels);
-        
-        for (int i = 0; i < count; i++) {
-            
-            blendFunction(newPixels[i], *fDevice.getAddr(left + i, y));
+    /**
+     * @brief Returns true if every pixel the paint's source produces is known to be opaque.
+     */
+    static bool sourceIsOpaque(const GPaint& paint) {
+        GShader* shader = paint.getShader();
+        if (shader != nullptr) {
+            return shader->isOpaque();
         }
-    
+        return GPixel_GetA(makePremultPixel(paint.getColor())) == 255;
     }
 
-    void blit(const int left, const int right, int y, BlendFunction blendFunction, GPixel pixel) {
-        int count = right - left;
-        
-        for (int i = 0; i < count; i++) {
-            blendFunction(pixel, *fDevice.getAddr(left + i, y));
+    /**
+     * @brief Returns the blend mode a draw with the paint reduces to, once its source's opacity
+     * is taken into account. kDst means the draw leaves every pixel as it is.
+     */
+    static GBlendMode effectiveBlendMode(const GPaint& paint) {
+        bool transparent = paint.getShader() == nullptr && makePremultPixel(paint.getColor()) == 0;
+        return reduceBlendMode(paint.getBlendMode(), sourceIsOpaque(paint), transparent);
+    }
+
+    /**
+     * @brief Returns true if a draw with the paint can be skipped without looking at its geometry.
+     */
+    static bool drawsNothing(const GPaint& paint) {
+        if (effectiveBlendMode(paint) != GBlendMode::kDst) {
+            return false;
         }
-        
+        gElidedDraws.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Picks the span blenders for a draw with the paint, after reducing its blend mode and
+     * specializing for an opaque source.
+     */
+    static const BlendSpanProcs& chooseBlendProcs(const GPaint& paint) {
+        GBlendMode mode = effectiveBlendMode(paint);
+        if (mode != paint.getBlendMode()) {
+            std::atomic<long>& counter = mode == GBlendMode::kSrc ? gReducedToSrc : gReducedToClear;
+            counter.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (paint.getShader() == nullptr && (mode == GBlendMode::kSrc || mode == GBlendMode::kClear)) {
+            gSolidStores.fetch_add(1, std::memory_order_relaxed);
+        }
+        return getBlendSpanProcs(mode, sourceIsOpaque(paint));
+    }
+
+    /**
+     * @brief Makes the blitter a draw with the paint fills through, out of scratch. The paint's
+     * shader, if it has one, must already have its context set.
+     */
+    Blitter* makeBlitter(const GPaint& paint, const BlendSpanProcs& blendProcs, ScratchArena& scratch) {
+        GShader* shader = paint.getShader();
+        if (shader == nullptr) {
+            GPixel pixel = makePremultPixel(paint.getColor());
+            return new (scratch.allocate<SolidBlitter>(1)) SolidBlitter(fDevice, pixel, blendProcs);
+        }
+        GPixel* shadeBuffer = scratch.allocate<GPixel>(fDevice.width());
+        return new (scratch.allocate<ShaderBlitter>(1)) ShaderBlitter(fDevice, shader, blendProcs, shadeBuffer);
+    }
+
+    /**
+     * @brief Fills the outline accumulated in the coverage rasterizer with the paint, then empties it.
+     * 
+     * @param paint the paint to fill with.
+     */
+    void fillCoverage(const GPaint& paint) {
+        const BlendSpanProcs& bf = chooseBlendProcs(paint);
+        GShader* gs = paint.getShader();
+        if (gs != nullptr) {
+            gs->setContext(transformationStack.top());
+        }
+
+        coverageRasterizer.sweep(*makeBlitter(paint, bf, arena), clip);
+        coverageRasterizer.reset();
     }
 
 
@@ -68,28 +155,42 @@ public:
      * @param color the color to fill the canvas.
      */
     void drawPaint(const GPaint& paint) override {
-        GRect screenRect = GRect::MakeLTRB(0,0,fDevice.width(), fDevice.height());
-        if (paint.getShader() == nullptr) {
-            GPixel newPixel = makePremultPixel(paint.getColor());
-            for (int y = 0; y < fDevice.height(); y++) {
-                blit(0, fDevice.width(), y,getBlendFunction(paint.getBlendMode()), newPixel);
-            }
-        } else {
-            paint.getShader()->setContext(transformationStack.top());
-            for (int y = 0; y < fDevice.height(); y++) {
-                blit(0, fDevice.width(), y,getBlendFunction(paint.getBlendMode()), paint.getShader());
-            }
+        if (drawsNothing(paint)) {
+            return;
         }
+        blitRect(clip, paint);
     }
 
     /**
      * @brief Draws a rectangle of the given color to the canvas.
+     * If the CTM only scales and translates, the rectangle stays axis-aligned in device space and is
+     * filled directly, skipping edge building entirely.
      * 
      * @param rect the rectangle to draw.
      * @param paint the color to draw the rectangle.
      */
     void drawRect(const GRect& rect, const GPaint& paint) override {
-        
+        if (drawsNothing(paint)) {
+            return;
+        }
+        const GMatrix& ctm = transformationStack.top();
+
+        if (ctm[1] == 0 && ctm[3] == 0 && !paint.isAntiAlias()) {
+            GPoint corners[2];
+            corners[0] = GPoint::Make(rect.left(), rect.top());
+            corners[1] = GPoint::Make(rect.right(), rect.bottom());
+            ctm.mapPoints(corners, corners, 2);
+
+            GRect deviceRect = GRect::MakeLTRB(
+                std::min(corners[0].x(), corners[1].x()),
+                std::min(corners[0].y(), corners[1].y()),
+                std::max(corners[0].x(), corners[1].x()),
+                std::max(corners[0].y(), corners[1].y())
+            );
+            blitRect(clipGIRect(deviceRect.round()), paint);
+            return;
+        }
+
         GPoint points[4];
 
         points[0] = GPoint::Make(rect.left(),rect.top());
@@ -98,39 +199,87 @@ public:
         points[3] = GPoint::Make(rect.right(),rect.top());
         
         drawConvexPolygon(points, 4,paint);
+    }
 
-        // GIRect transformedRect;
-
-        // GIRect newRect = clipGIRectToCanvas(rect.round());
-        // if (newRect.top() == newRect.bottom()) {
-        //     return;
-        // }
-        // BlendFunction bf = getBlendFunction(paint.getBlendMode());
-        // if (paint.getShader() == nullptr) {
-        //     GPixel newPixel = makePremultPixel(paint.getColor());
-        //     for (int y = newRect.top(); y < newRect.bottom(); y++ ) {
-        //       blit(newRect.left(), newRect.right(), y, bf, newPixel);
-        //     }
-        // } else {
-        //     for (int y = newRect.top(); y < newRect.bottom(); y++ ) {
-        //         paint.getShader()->setContext(ctm);
-        //       blit(newRect.left(), newRect.right(), y, bf, paint.getShader());
-        //     }
-        // }
+    /**
+     * @brief Fills a device-space rectangle that has already been clipped to the canvas.
+     * 
+     * @param rect the rectangle to fill.
+     * @param paint the paint to fill it with.
+     */
+    void blitRect(const GIRect& rect, const GPaint& paint) {
+        if (rect.isEmpty()) {
+            return;
+        }
+        arena.reset();
+
+        const BlendSpanProcs& bf = chooseBlendProcs(paint);
+        GShader* gs = paint.getShader();
+
+        if (gs != nullptr) {
+            gs->setContext(transformationStack.top());
+        }
+
+        forEachBand(rect.top(), rect.bottom(), gs, [&](int top, int bottom, ScratchArena& bandArena) {
+            makeBlitter(paint, bf, bandArena)->blitRect(rect.left(), top, rect.width(), bottom - top);
+        });
+    }
+
+    /**
+     * @brief Splits the rows [top, bottom) of one draw into horizontal bands and calls
+     * bandProc(bandTop, bandBottom, bandArena) for each, spreading the bands across the band
+     * threads. Rows never share pixels, so this only pays attention to whether the shader can be
+     * shared and whether the draw is large enough to be worth waking the other threads for.
+     * Each band gets scratch memory of its own; when the draw is not split, that is the canvas
+     * arena, which the caller may already have allocated from.
+     */
+    template <typename BandProc> void forEachBand(int top, int bottom, GShader* shader, BandProc bandProc) {
+        int rows = bottom - top;
+        int bandCount = std::min(bandThreads * kBandsPerThread, rows / kMinBandRows);
+        bool shareable = shader == nullptr || shader->canShadeConcurrently();
+
+        if (bandCount < 2 || !shareable || (long long) rows * fDevice.width() < kMinBandedPixels) {
+            if (rows > 0) {
+                bandProc(top, bottom, arena);
+            }
+            return;
+        }
+
+        if (!bandPool) {
+            bandPool.reset(new ThreadPool(bandThreads));
+        }
+        if (bandArenas.size() < (size_t) bandCount) {
+            bandArenas.resize(bandCount);
+        }
+        bandPool->parallelFor(bandCount, [&](int band) {
+            int bandTop = top + (int) ((long long) rows * band / bandCount);
+            int bandBottom = top + (int) ((long long) rows * (band + 1) / bandCount);
+            bandArenas[band].reset();
+            bandProc(bandTop, bandBottom, bandArenas[band]);
+        });
     }
 
     void drawConvexPolygon(const GPoint points[], int count, const GPaint& paint) override {
         
-        if (count < 3) {
+        if (count < 3 || drawsNothing(paint)) {
             return;
         }
+        arena.reset();
+        edgeList.clear();
 
-        std::vector<Edge> edgeList;
-        
-        GPoint transformedPoints[count];
+        GPoint* transformedPoints = arena.allocate<GPoint>(count);
 
         transformationStack.top().mapPoints(transformedPoints, points, count);
 
+        if (paint.isAntiAlias()) {
+            for (int i = 1; i < count; i++) {
+                coverageRasterizer.addLine(transformedPoints[i-1], transformedPoints[i]);
+            }
+            coverageRasterizer.addLine(transformedPoints[count-1], transformedPoints[0]);
+            fillCoverage(paint);
+            return;
+        }
+
         for (int i = 1; i < count; i++) {
             eBuilder.generateAndAddEdge(transformedPoints[i],transformedPoints[i-1], edgeList);
         }
@@ -146,42 +295,41 @@ public:
         int indexL = 0;
         int indexR = 1;
         int totalIndex = 1;
-        int currentY = edgeList[0].yTop;
+        int currentY = std::max(edgeList[0].yTop, clip.top());
+
+        // Rows above the clip are never drawn, so hand over every edge that ends above it and
+        // move the two current edges straight down to the first row inside it.
+        while (totalIndex < edgeList.size()) {
+            int& index = edgeList[indexL].yBottom <= edgeList[indexR].yBottom ? indexL : indexR;
+            if (edgeList[index].yBottom > currentY) {
+                break;
+            }
+            totalIndex++;
+            index = totalIndex;
+        }
+        if (totalIndex >= edgeList.size()) {
+            return;
+        }
+        advanceEdge(edgeList[indexL], currentY - edgeList[indexL].yTop);
+        advanceEdge(edgeList[indexR], currentY - edgeList[indexR].yTop);
+
+        const BlendSpanProcs& bf = chooseBlendProcs(paint);
+        GShader* gs = paint.getShader();
+        if (gs != nullptr) {
+            gs->setContext(transformationStack.top());
+        }
+        Blitter* blitter = makeBlitter(paint, bf, arena);
 
-        BlendFunction bf = getBlendFunction(paint.getBlendMode());
+        while (totalIndex < edgeList.size() && currentY < clip.bottom()) {
+            int xL = getCurrentX(edgeList[indexL]);
+            int xR = getCurrentX(edgeList[indexR]);
 
-        if (paint.getShader() == nullptr) {
-            GPixel newPixel = makePremultPixel(paint.getColor());
-         
-            while (totalIndex < edgeList.size()) {
-                int xL = getX(edgeList[indexL],currentY); 
-                int xR = getX(edgeList[indexR],currentY);
-                
-                blit(xL, xR, currentY, bf, newPixel);
-                currentY++;
-                if (currentY >= edgeList[indexL].yBottom) {
-                    totalIndex++; 
-                    indexL = totalIndex;
-                }
-                if (currentY >= edgeList[indexR].yBottom) {
-                    totalIndex++; 
-                    indexR = totalIndex;
-                }
+            if (clipSpan(xL, xR, currentY)) {
+                blitter->blitH(xL, currentY, xR - xL);
             }
-        } else {
-            
-            GShader* gs = paint.getShader();
-            gs->setContext(transformationStack.top());
-            //debug(fDevice.width(), fDevice.height(), "[", "]");
-            while (totalIndex < edgeList.size()) {
-            int xL = getX(edgeList[indexL],currentY); 
-            int xR = getX(edgeList[indexR],currentY);
-
-            // debug(xL, xR, "<", ">");
-            //debug("s1");
-            blit(xL, xR, currentY, bf, gs);
-            //debug("s2");
-            //debug(0, 0, "", "");
+
+            stepEdge(edgeList[indexL]);
+            stepEdge(edgeList[indexR]);
             currentY++;
             if (currentY >= edgeList[indexL].yBottom) {
                 totalIndex++; 
@@ -191,25 +339,23 @@ public:
                 totalIndex++; 
                 indexR = totalIndex;
             }
-        } 
-        
-    }
+        }
     }
 
    
 
     /**
-     * @brief returns a rectangle representing the intersection of the given rectangle and the canvas size. 
+     * @brief returns a rectangle representing the intersection of the given rectangle and the canvas clip. 
      * 
      * @param rect the rectangle to clip.
-     * @return GIRect a rectangle representing the intersection of the given rectangle and the canvas size. 
+     * @return GIRect a rectangle representing the intersection of the given rectangle and the canvas clip. 
      */
-    GIRect clipGIRectToCanvas(const GIRect& rect) const {
+    GIRect clipGIRect(const GIRect& rect) const {
         
-        int l = std::max(rect.left(), 0);
-        int t = std::max(rect.top(),0);
-        int r = std::min(rect.right(), fDevice.width()-1);
-        int b = std::min(rect.bottom(),  fDevice.height()-1);
+        int l = std::max(rect.left(), clip.left());
+        int t = std::max(rect.top(), clip.top());
+        int r = std::min(rect.right(), clip.right());
+        int b = std::min(rect.bottom(), clip.bottom());
         return(GIRect::MakeLTRB(l,t,r,b));
     }
 
@@ -223,19 +369,55 @@ public:
 
     void save() {
         GMatrix ctm = transformationStack.top();
-        transformationStack.push(*new GMatrix(ctm[0], ctm[1], ctm[2], ctm[3], ctm[4], ctm[5]));
+        transformationStack.push(ctm);
+    }
+
+    /**
+     * @brief Returns the next segment of the path's outline, mapped to device space by the CTM.
+     * Mapping each segment as it comes up saves copying and transforming the whole path.
+     */
+    GPath::Verb nextDeviceSegment(GPath::Edger& edger, GPoint pts[]) {
+        GPath::Verb verb = edger.next(pts);
+        switch (verb) {
+            case GPath::kLine:  transformationStack.top().mapPoints(pts, 2); break;
+            case GPath::kQuad:  transformationStack.top().mapPoints(pts, 3); break;
+            case GPath::kCubic: transformationStack.top().mapPoints(pts, 4); break;
+            default: break;
+        }
+        return verb;
     }
 
     void drawPath(const GPath& path, const GPaint& paint) {
-        
-        std::vector<Edge> edgeList;
-        auto tPath = path;
-        tPath.transform(transformationStack.top());
+        if (drawsNothing(paint)) {
+            return;
+        }
+        arena.reset();
+        edgeList.clear();
         
         GPoint pts[GPath::kMaxNextPoints];
-        GPath::Edger myEdger(tPath);
+        GPath::Edger myEdger(path);
         GPath::Verb myVerb;
-        while ( (myVerb = myEdger.next(pts)) != GPath::kDone) {
+
+        if (paint.isAntiAlias()) {
+            while ( (myVerb = nextDeviceSegment(myEdger, pts)) != GPath::kDone) {
+                switch (myVerb) {
+                    case GPath::kLine:
+                        coverageRasterizer.addLine(pts[0],pts[1]);
+                        break;
+                    case GPath::kQuad:
+                        coverageRasterizer.addQuad(pts[0],pts[1],pts[2], 0.25);
+                        break;
+                    case GPath::kCubic:
+                        coverageRasterizer.addCubic(pts[0],pts[1],pts[2],pts[3], 0.25);
+                        break;
+                    default: break;
+                }
+            }
+            fillCoverage(paint);
+            return;
+        }
+
+        while ( (myVerb = nextDeviceSegment(myEdger, pts)) != GPath::kDone) {
             
             switch (myVerb) {
                 case GPath::kLine:
@@ -257,83 +439,96 @@ public:
             return;
         }
         std::sort(edgeList.begin(), edgeList.end(), compareEdgeLessThan);
-    
-        int yTop = edgeList[0].yTop;
-        int yBottom = 0;
-        for (Edge e: edgeList) {
-            if (e.yBottom > yBottom) {
-                yBottom = e.yBottom;
-            }
+
+        const BlendSpanProcs& bf = chooseBlendProcs(paint);
+        GShader* gs = paint.getShader();
+        if (gs != nullptr) {
+            gs->setContext(transformationStack.top());
         }
-     
-        for (int y = yTop; y < yBottom; y++) {
-          
-            
-            std::vector<Edge> activeEdges;
-            int wind = 0;
-            for (Edge e: edgeList) {
-                if (e.yTop <= y + 0.5 && e.yBottom >= y + 0.5) {
-                    activeEdges.push_back(e);
+
+        int top = std::max(edgeList[0].yTop, clip.top());
+        int bottom = clip.top();
+        for (const Edge& e: edgeList) {
+            bottom = std::max(bottom, e.yBottom);
+        }
+        bottom = std::min(bottom, clip.bottom());
+
+        // The sorted edge list is shared by every band; each band keeps its own active table.
+        forEachBand(top, bottom, gs, [&](int bandTop, int bandBottom, ScratchArena& bandArena) {
+            fillEdgeRows(edgeList, bandTop, bandBottom, *makeBlitter(paint, bf, bandArena), bandArena);
+        });
+    }
+
+    /**
+     * @brief Fills the rows [top, bottom) of a path under the non-zero winding rule.
+     * Edges enter the active table when y reaches their top and leave once y passes their
+     * bottom. The table stays sorted by x, so each row only needs an insertion sort.
+     * 
+     * @param edgeList every edge of the path, sorted by compareEdgeLessThan.
+     * @param scratch where the active edge table lives.
+     */
+    void fillEdgeRows(const std::vector<Edge>& edgeList, int top, int bottom, Blitter& blitter, ScratchArena& scratch) {
+        Edge* activeEdges = scratch.allocate<Edge>(edgeList.size());
+        size_t activeCount = 0;
+        size_t nextEdge = 0;
+        int y = std::max(edgeList[0].yTop, top);
+
+        while ((nextEdge < edgeList.size() || activeCount > 0) && y < bottom) {
+
+            if (activeCount == 0 && edgeList[nextEdge].yTop > y) {
+                y = edgeList[nextEdge].yTop;
+                if (y >= bottom) {
+                    break;
                 }
             }
-            
-            //std::sort(activeEdges.begin(),activeEdges.end(),std::bind(compareEdgesByX, std::placeholders::_1, std::placeholders::_2, y));
-            std::sort(activeEdges.begin(),activeEdges.end(),[y]( Edge& a,  Edge& b) { 
-                return compareEdgesByX(a,b,y); 
-            });
 
-            int left;
-            int right;
-            
-            if (paint.getShader() == nullptr) {
-                
-                for (Edge e: activeEdges) {
-                    int x = getX(e, y);
-                    //debug(x,y,"(",")"); 
-                    // if (x < 0 || x > fDevice.width() - 1) {
-                    //     debug(x,y,"(",")");    
-                    //     debug(fDevice.width(),fDevice.height(),"<",">");
-                    // }
-                    
-                     if (wind == 0) {
-                        left = x;
-                    }
-                    wind = wind + e.orientation;
-                    if (wind == 0) {
-                        right = x;
-
-                        if (right > fDevice.width()) {
-                            right = fDevice.width()-1;
-                        }
-                        // debug(left, right, "(", ")");
-                        // debug();
-                        // debug();
-                        blit(left, right, y, getBlendFunction(paint.getBlendMode()), makePremultPixel(paint.getColor()));
-                        // debug("end");
-                    }
-                    
+            size_t kept = 0;
+            for (size_t i = 0; i < activeCount; i++) {
+                if (activeEdges[i].yBottom > y) {
+                    activeEdges[kept++] = activeEdges[i];
                 }
-                
-            } else {
-                //debug("oi");
-                GShader* gs = paint.getShader();
-                gs->setContext(transformationStack.top());
-                for (Edge e: activeEdges) {
-                    
-                    int x = getX(e, y);
-                    if (wind == 0) {
-                        left = x;
-                    }
-                    wind = wind + e.orientation;
-                    if (wind == 0) {
-                        right = x;
-                        blit(left, right, y, getBlendFunction(paint.getBlendMode()), gs);
+            }
+            activeCount = kept;
+
+            while (nextEdge < edgeList.size() && edgeList[nextEdge].yTop <= y) {
+                const Edge& e = edgeList[nextEdge++];
+                if (e.yBottom > y) {
+                    activeEdges[activeCount] = e;
+                    advanceEdge(activeEdges[activeCount], y - e.yTop);
+                    activeCount++;
+                }
+            }
+
+            for (size_t i = 1; i < activeCount; i++) {
+                Edge e = activeEdges[i];
+                size_t j = i;
+                while (j > 0 && activeEdges[j-1].x > e.x) {
+                    activeEdges[j] = activeEdges[j-1];
+                    j--;
+                }
+                activeEdges[j] = e;
+            }
+
+            int wind = 0;
+            int left = 0;
+            for (size_t i = 0; i < activeCount; i++) {
+                Edge& e = activeEdges[i];
+                int x = getCurrentX(e);
+                if (wind == 0) {
+                    left = x;
+                }
+                wind = wind + e.orientation;
+                if (wind == 0) {
+                    int right = x;
+                    if (clipSpan(left, right, y)) {
+                        blitter.blitH(left, y, right - left);
                     }
                 }
+                stepEdge(e);
             }
 
+            y++;
         }
-        
     }
 
     void drawTri(GPoint points[], GPaint paint) {
@@ -347,163 +542,231 @@ public:
     }
 
 
+    /**
+     * @brief Fills one mesh triangle, given in device space, with a shader that has already been
+     * built for it in device space. Triangles are scanned directly from their corners; only
+     * anti-aliased triangles and ones too large for fixed-point stepping take the path filler.
+     */
+    void drawTriangle(GPoint points[], GShader* shader, const GPaint& paint, ShaderBlitter& blitter) {
+        if (paint.isAntiAlias() || !TriangleRasterizer::canRasterize(points)) {
+            GPaint triPaint = GPaint(shader);
+            triPaint.setAntiAlias(paint.isAntiAlias());
+            triPaint.setBlendMode(paint.getBlendMode());
+
+            save();
+            transformationStack.top() = GMatrix();
+            drawTri(points, triPaint);
+            restore();
+            return;
+        }
+
+        if (!shader->setContext(GMatrix())) {
+            return;
+        }
+        GBlendMode mode = reduceBlendMode(paint.getBlendMode(), shader->isOpaque(), false);
+        blitter.setBlendProcs(getBlendSpanProcs(mode, shader->isOpaque()));
+        TriangleRasterizer::blit(points, clip, blitter);
+    }
+
     void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count, const int indices[], const GPaint& paint) {
-        
+        // Texture coordinates mean nothing without a shader to look them up in.
+        if (paint.getShader() == nullptr) {
+            texs = nullptr;
+        }
+        if (count < 1 || (colors == nullptr && texs == nullptr)) {
+            return;
+        }
+        if (paint.getBlendMode() == GBlendMode::kDst) {
+            gElidedDraws.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        // The vertex cache lives in its own arena, since triangles that fall back to the path
+        // filler reset the per-draw one.
+        meshArena.reset();
+        meshVertices.prepare(verts, colors, texs, indices, count, transformationStack.top(), meshArena);
+        GPixel* shadeBuffer = meshArena.allocate<GPixel>(fDevice.width());
+
+        // One shader of each kind serves every triangle, so shading a triangle only resets their
+        // interpolation state and never allocates.
+        TriColorShader colorShader;
+        TriBitmapShader textureShader(paint.getShader());
+        TexturedColorShader combinedShader(&textureShader, &colorShader);
+
+        GShader* triangleShader;
+        if (!meshVertices.textured()) {
+            triangleShader = &colorShader;
+        } else if (!meshVertices.colored()) {
+            triangleShader = &textureShader;
+        } else {
+            triangleShader = &combinedShader;
+        }
+        ShaderBlitter blitter(fDevice, triangleShader, getBlendSpanProcs(paint.getBlendMode()), shadeBuffer);
+
         GPoint p[3];
         GColor c[3];
         GPoint t[3];
-
-        GShader* triangleShader;
-        std::unique_ptr<GShader> colorShader;
-        std::unique_ptr<GShader> textureShader;
-        std::unique_ptr<GShader> combinedShader;
-        
         for (int i = 0; i < count; i++) {
-            //printf("<%d,%d,%d>\n", indices[3*i   ], indices[(3*i) +1], indices[(3*i) +2]);
-            p[0] = verts[indices[3*i]];
-            p[1] = verts[indices[(3*i) +1]];
-            p[2] = verts[indices[(3*i) +2]];
+            const int* corners = &indices[3*i];
+            for (int k = 0; k < 3; k++) {
+                p[k] = meshVertices.point(corners[k]);
+            }
             
-            if (texs != nullptr) {
-                t[0] = texs[indices[3*i]];
-                t[1] = texs[indices[(3*i)+1]];
-                t[2] = texs[indices[(3*i)+2]];
-                textureShader = GCreateTriBitmapShader(p,t,paint.getShader());
+            if (meshVertices.textured()) {
+                for (int k = 0; k < 3; k++) {
+                    t[k] = meshVertices.tex(corners[k]);
+                }
+                textureShader.setTriangle(p, t);
             }
 
-            if (colors != nullptr) {
-                c[0] = colors[indices[3*i]];
-                c[1] = colors[indices[(3*i) + 1]];
-                c[2] = colors[indices[(3*i) + 2]];
-                colorShader = GCreateTriColorShader(p, c);
+            if (meshVertices.colored()) {
+                for (int k = 0; k < 3; k++) {
+                    c[k] = meshVertices.color(corners[k]);
+                }
+                colorShader.setTriangle(p, c);
             }
 
-            if (texs == nullptr) {
-                triangleShader = colorShader.get();
-            } else if (colors == nullptr) {
-                triangleShader = textureShader.get();
-            } else {
-                combinedShader = GCreateComposedShader(
-                        textureShader.get(),
-                        colorShader.get()
-                    );
-                triangleShader = combinedShader.get();
-            }
-            assert(triangleShader != nullptr);
-            // triangleShader->setContext(GMatrix());
-            GPaint myPaint = GPaint(triangleShader);
-            // myPaint.setColor(myPaint.getColor());
-            // myPaint.setBlendMode(myPaint.getBlendMode());
-            drawTri(p,myPaint);
+            drawTriangle(p, triangleShader, paint, blitter);
         }
 
     }
 
-    GPoint interpolatePoint(GPoint p1, GPoint p2, float a) {
-        return GPoint::Make(
-            (p1.x() * a) + (p2.x() * (1-a)),
-            (p1.y() * a) + (p2.y() * (1-a))
-        );
+    /**
+     * @brief Fills row[0..columns] with points spaced evenly from left to right, stepping from
+     * one to the next and landing exactly on right.
+     */
+    template <typename T> static void stepQuadRow(const T& left, const T& right, int columns, T row[]) {
+        auto step = (right - left) * (1.0f / columns);
+        T value = left;
+        for (int i = 0; i < columns; i++) {
+            row[i] = value;
+            value += step;
+        }
+        row[columns] = right;
     }
 
-    GColor interpolateColor(GColor c1, GColor c2, float a) {
-        return GColor::RGBA(
-            (c1.r * a) + (c2.r * (1-a)),
-            (c1.g * a) + (c2.g * (1-a)),
-            (c1.b * a) + (c2.b * (1-a)),
-            (c1.a * a) + (c2.a * (1-a))
-        );
+    /**
+     * @brief Returns the triangle indices for chunkRows rows of quads, level + 1 quads to a row,
+     * numbering the vertices row by row. Every chunk of a quad reuses the same indices, and the
+     * last level's set is kept for the next drawQuad.
+     */
+    const int* quadIndexTemplate(int level, int chunkRows) {
+        if (level == quadIndicesLevel) {
+            return quadIndices.data();
+        }
+        int columns = level + 1;
+        int rowVerts = columns + 1;
+        quadIndices.clear();
+        for (int row = 0; row < chunkRows; row++) {
+            for (int column = 0; column < columns; column++) {
+                // Split on the top-right to bottom-left diagonal.
+                int topLeft = (row * rowVerts) + column;
+                int topRight = topLeft + 1;
+                int bottomLeft = topLeft + rowVerts;
+                int bottomRight = bottomLeft + 1;
+                quadIndices.insert(quadIndices.end(), {
+                    topLeft, topRight, bottomLeft,
+                    bottomRight, topRight, bottomLeft,
+                });
+            }
+        }
+        quadIndicesLevel = level;
+        return quadIndices.data();
     }
 
     void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level, const GPaint& paint) {
-        
-        
-        int numTriangles = (level+1)*(level+1) * 2;
-        int indices[numTriangles * 3];
-
-        int numVerts = (level+2)*(level+2);
-        int vertsIndexGrid[level+2][level+2];
-        GPoint newVerts[numVerts];
-        GColor newColors[numVerts];
-        GPoint newTexs[numVerts];
- 
+        level = std::max(level, 0);
+        int columns = level + 1;
+        int rowVerts = columns + 1;
+
+        // Vertices are generated a row at a time and handed to drawMesh in chunks of rows, so
+        // memory stays bounded however fine the tessellation is.
+        int chunkRows = std::max(1, kQuadChunkTriangles / (2 * columns));
+        const int* indices = quadIndexTemplate(level, chunkRows);
+
+        size_t chunkVerts = (size_t) (chunkRows + 1) * rowVerts;
+        quadVerts.resize(std::max(quadVerts.size(), chunkVerts));
+        if (colors != nullptr) {
+            quadColors.resize(std::max(quadColors.size(), chunkVerts));
+        }
+        if (texs != nullptr) {
+            quadTexs.resize(std::max(quadTexs.size(), chunkVerts));
+        }
 
-        int index = 0;
-        
-        float a = 0;
-        float da = 1.0/(level+1);
-        float db = 1.0/(level+1);
+        // The ends of each row step down the left (0 to 3) and right (1 to 2) sides of the quad.
+        float rowStep = 1.0f / columns;
+        GPoint left = verts[0];
+        GPoint right = verts[1];
+        GVector leftStep = (verts[3] - verts[0]) * rowStep;
+        GVector rightStep = (verts[2] - verts[1]) * rowStep;
+        GColor colorLeft, colorRight, colorLeftStep, colorRightStep;
+        if (colors != nullptr) {
+            colorLeft = colors[0];
+            colorRight = colors[1];
+            colorLeftStep = (colors[3] - colors[0]) * rowStep;
+            colorRightStep = (colors[2] - colors[1]) * rowStep;
+        }
+        GPoint texLeft, texRight;
+        GVector texLeftStep, texRightStep;
+        if (texs != nullptr) {
+            texLeft = texs[0];
+            texRight = texs[1];
+            texLeftStep = (texs[3] - texs[0]) * rowStep;
+            texRightStep = (texs[2] - texs[1]) * rowStep;
+        }
 
-        for (int i = 0; i <= level+1; i++) {
-            if (i == level+1) {
-                a = 1;
+        int bufferedRows = 0;
+        for (int row = 0; row <= columns; row++) {
+            if (row == columns) {
+                left = verts[3];
+                right = verts[2];
+                if (colors != nullptr) {
+                    colorLeft = colors[3];
+                    colorRight = colors[2];
+                }
+                if (texs != nullptr) {
+                    texLeft = texs[3];
+                    texRight = texs[2];
+                }
             }
 
-            GPoint P1 = interpolatePoint(verts[1], verts[0], a);
-
-            GPoint P2 = interpolatePoint(verts[2], verts[3], a);
-
-            GColor C1;
-            GColor C2;
-
+            int offset = bufferedRows * rowVerts;
+            stepQuadRow(left, right, columns, &quadVerts[offset]);
             if (colors != nullptr) {
-                C1 = interpolateColor(colors[1], colors[0], a);
-                C2 = interpolateColor(colors[2], colors[3], a);
+                stepQuadRow(colorLeft, colorRight, columns, &quadColors[offset]);
             }
-
-            GPoint TP1;
-            GPoint TP2;
-
             if (texs != nullptr) {
-                TP1 = interpolatePoint(texs[1], texs[0], a);
-                TP2 = interpolatePoint(texs[2], texs[3], a);
+                stepQuadRow(texLeft, texRight, columns, &quadTexs[offset]);
             }
+            bufferedRows++;
 
-            float b = 0;
-
-            for (int j = 0; j <= level+1; j++) {
-                if (j == level+1) {
-                    b = 1;
-                }
-
-                
-                newVerts[index] = interpolatePoint(P2, P1, b);
-                vertsIndexGrid[i][j] = index;
+            if (row > 0 && (bufferedRows == chunkRows + 1 || row == columns)) {
+                drawMesh(quadVerts.data(),
+                         colors != nullptr ? quadColors.data() : nullptr,
+                         texs != nullptr ? quadTexs.data() : nullptr,
+                         (bufferedRows - 1) * columns * 2, indices, paint);
 
+                // The chunk's last row is the first row of the next one.
+                std::copy_n(&quadVerts[offset], rowVerts, quadVerts.begin());
                 if (colors != nullptr) {
-                    newColors[index] = interpolateColor(C2, C1, b);
+                    std::copy_n(&quadColors[offset], rowVerts, quadColors.begin());
                 }
-
                 if (texs != nullptr) {
-                    newTexs[index] =  interpolatePoint(TP2, TP1, b);
+                    std::copy_n(&quadTexs[offset], rowVerts, quadTexs.begin());
                 }
-
-                b += db;
-                index++;
+                bufferedRows = 1;
             }
-            a += da;
-        }
 
-        int count = 0;
-        for (int i = 0; i < level+1; i++) {
-            for (int j = 0; j < level+1; j++) {
-                indices[count] = vertsIndexGrid[i][j];
-                indices[count+1] = vertsIndexGrid[i+1][j];
-                indices[count+2] = vertsIndexGrid[i][j+1];
-                indices[count+3] = vertsIndexGrid[i+1][j+1];
-                indices[count+4] = vertsIndexGrid[i+1][j];
-                indices[count+5] = vertsIndexGrid[i][j+1];
-
-                count+=6;
+            left += leftStep;
+            right += rightStep;
+            if (colors != nullptr) {
+                colorLeft += colorLeftStep;
+                colorRight += colorRightStep;
+            }
+            if (texs != nullptr) {
+                texLeft += texLeftStep;
+                texRight += texRightStep;
             }
-        }
-        
-        if (colors == nullptr) {
-            drawMesh(newVerts, nullptr, newTexs, numTriangles, indices, paint);
-        } else if (texs == nullptr) {
-             drawMesh(newVerts, newColors, nullptr, numTriangles, indices, paint);
-        } else {
-            drawMesh(newVerts, newColors, newTexs, numTriangles, indices, paint);
         }
     }
 
@@ -658,7 +921,46 @@ private:
 
     EdgeBuilder eBuilder;
 
-    std::stack<GMatrix> transformationStack;
+    CoverageRasterizer coverageRasterizer;
+
+    // Device pixels this canvas may write to.
+    const GIRect clip;
+
+    // Draws smaller than this many pixels, or bands shorter than this many rows, are not split.
+    static const int kMinBandedPixels = 1 << 18;
+    static const int kMinBandRows = 32;
+
+    // A few bands per thread keeps every thread busy when some bands are cheaper than others.
+    static const int kBandsPerThread = 4;
+
+    const int bandThreads;
+
+    // Created the first time a draw is split into bands.
+    std::unique_ptr<ThreadPool> bandPool;
+
+    std::stack<GMatrix, std::vector<GMatrix>> transformationStack;
+
+    // Per-draw scratch memory for this thread, plus one arena per band when a draw is split.
+    ScratchArena arena;
+    std::vector<ScratchArena> bandArenas;
+
+    // The current drawMesh's vertices, mapped and premultiplied once, and the arena they live in.
+    ScratchArena meshArena;
+    MeshVertexCache meshVertices;
+
+    // Reused by every draw, so building edges stops allocating once it has grown big enough.
+    std::vector<Edge> edgeList;
+
+    // drawQuad hands drawMesh at most about this many triangles at once.
+    static const int kQuadChunkTriangles = 1 << 12;
+
+    // The triangle indices for a chunk of drawQuad rows at quadIndicesLevel, and the vertex rows
+    // of the chunk being built.
+    std::vector<int> quadIndices;
+    int quadIndicesLevel = -1;
+    std::vector<GPoint> quadVerts;
+    std::vector<GColor> quadColors;
+    std::vector<GPoint> quadTexs;
 
     float crossProduct(GVector a, GVector b) {
         return a.x()*b.y() - a.y()*b.x();
@@ -680,6 +982,25 @@ std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& device) {
     return std::unique_ptr<GCanvas>(new BasicCanvas(device));
 }
 
+std::unique_ptr<GCanvas> GCreateBandedCanvas(const GBitmap& device, int threadCount) {
+    return std::unique_ptr<GCanvas>(new BasicCanvas(device, threadCount));
+}
+
+std::unique_ptr<GCanvas> GCreateClippedCanvas(const GBitmap& device, const GIRect& clip) {
+    return std::unique_ptr<GCanvas>(new BasicCanvas(device, clip));
+}
+
+GBlendReductionStats GGetBlendReductionStats() {
+    return { gReducedToSrc.load(), gReducedToClear.load(), gElidedDraws.load(), gSolidStores.load() };
+}
+
+void GResetBlendReductionStats() {
+    gReducedToSrc = 0;
+    gReducedToClear = 0;
+    gElidedDraws = 0;
+    gSolidStores = 0;
+}
+
 std::string GDrawSomething(GCanvas* canvas, GISize dim) {
     
     // GColor c = GColor::RGBA(1.0,1.0,1.0,1.0);
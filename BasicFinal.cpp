@@ -16,6 +16,10 @@ class BasicFinal: public GFinal {
         return GCreateFinalRadialGradient(center, radius, colors, count, mode);
     }
 
+    std::unique_ptr<GShader> createBilerpShader(const GBitmap& bitmap, const GMatrix& localMatrix) {
+        return GCreateBilerpShader(bitmap, localMatrix, GShader::kClamp, MipMap::kNearest);
+    }
+
     
     void addLine(GPath* path, GPoint p0, GPoint p1, float width, CapType cap) {
 
@@ -9,7 +9,14 @@ class BasicGradient : public GShader {
 
 public:
 
-    BasicGradient (GPoint p0, GPoint p1, const GColor color[] , int count, GShader::TileMode tileMode, GradientFunction gf) {
+    // Which of the shapes in GradientFunctions.h the gradient has.
+    enum Shape {
+        kLinear,
+        kRadial,
+        kRays,
+    };
+
+    BasicGradient (GPoint p0, GPoint p1, const GColor color[] , int count, GShader::TileMode tileMode, Shape shape) {
         float xM;
         float yM;
         
@@ -17,20 +24,28 @@ public:
         yM = p1.y() - p0.y();
 
         this->tileMode = tileMode;
-        gradientFunction = gf;
+        this->shape = shape;
         
         lm = GMatrix(
             xM,yM, p0.x(),
             yM,-xM, p0.y());
         tm = lm;
-        colorMap = std::vector<GColor>();
+        lut.build(color, count);
+
+        // Pixels are interpolated between neighbouring colors, so they are opaque exactly when
+        // every color is.
+        opaque = count > 0;
         for (int i = 0; i < count; i++) {
-            colorMap.push_back(color[i]);
+            opaque = opaque && color[i].a >= 1;
         }
     }
 
     bool isOpaque() {
-        return false;
+        return opaque;
+    }
+
+    bool canShadeConcurrently() {
+        return true;
     }
 
     bool setContext(const GMatrix& ctm) {
@@ -38,30 +53,18 @@ public:
     }
 
     void shadeRow(int x, int y, int count, GPixel row[]) {
-        GPoint pointSrc[count];
-        GPoint pointDst[count];
-        for (int i = 0; i < count; i++) {
-            pointSrc[i] = GPoint::Make(x + i + 0.5, y + 0.5);
-        }  
-        tm.mapPoints(pointDst,pointSrc,count);
-        for (int i = 0; i < count; i++) {
-            float xMapped = pointDst[i].x();
-            float yMapped = pointDst[i].y();
-            xMapped = gradientFunction(xMapped, yMapped);
-            //float yMapped = pointDst[i].y();
-
-            // if (xMapped >= bm.width()) {
-            //     xMapped = bm.width()-1;
-            // }
-        
-            // if (xMapped < 0) {
-            //     xMapped = 0;
-            // }
-           row[i] = getPixel(xMapped); 
-           
-            //std::cout << "\n" <<  "stop" << std::endl;
+        switch (shape) {
+            default:
+            case kLinear:
+                shadeGradientRow<LinearGradientMap>(tm, lut, tileMode, x, y, count, row);
+                break;
+            case kRadial:
+                shadeGradientRow<RadialGradientMap>(tm, lut, tileMode, x, y, count, row);
+                break;
+            case kRays:
+                shadeGradientRow<RayGradientMap>(tm, lut, tileMode, x, y, count, row);
+                break;
         }
-        // std::cout << "\n" <<  "fff" << std::endl;
     }
 
 private:
@@ -69,60 +72,32 @@ private:
     GMatrix tm;
     GMatrix lm;
     GBitmap bm;
-    std::vector<GColor> colorMap;
+    GradientLUT lut;
+    bool opaque;
     float size;
     GShader::TileMode tileMode;
 
-    GradientFunction gradientFunction;
-
-    GPixel getPixel(float x) {
-        if (colorMap.size() < 1) {
-            return makePremultPixel(GColor::RGBA(0,0,0,0));
-        }
-        if (colorMap.size() == 1) {
-            return makePremultPixel(colorMap.at(0));
-        }
-        switch (tileMode) {
-            default:
-            case GShader::kClamp:
-                if (x >= 1) {
-                    return makePremultPixel(colorMap.at(colorMap.size() -1));
-                }
-                if (x <= 0) {
-                    return makePremultPixel(colorMap.at(0));
-                }
-                break;
-            case GShader::kRepeat:
-                x = x-floor(x);
-                break;
-            case GShader::kMirror:
-                x *= 0.5;
-                x = x-floor(x);
-                x *= 2;
-        }
-        
-        float loc = x * (colorMap.size() - 1);
-        int index = GFloorToInt(loc);
-        float w = loc - index;
-        assert(index < colorMap.size() - 1);
-        return interpolate(colorMap.at(index), colorMap.at(index + 1),w);
-        
-    }
+    Shape shape;
 };
 
 std::unique_ptr<GShader> GCreateLinearGradient(GPoint p0, GPoint p1, const GColor color[] , int count) {
-    return (std::unique_ptr<GShader>) new BasicGradient(p0,p1,color, count, GShader::kClamp, mapToLinear);
+    return (std::unique_ptr<GShader>) new BasicGradient(p0,p1,color, count, GShader::kClamp, BasicGradient::kLinear);
 }
 
 std::unique_ptr<GShader> GCreateLinearGradient(GPoint p0, GPoint p1, const GColor color[] , int count, GShader::TileMode tileMode) {
-    return (std::unique_ptr<GShader>) new BasicGradient(p0,p1,color, count, tileMode, mapToLinear);
+    return (std::unique_ptr<GShader>) new BasicGradient(p0,p1,color, count, tileMode, BasicGradient::kLinear);
 }
 
 
 std::unique_ptr<GShader> GCreateRadialGradient(GPoint p0, GPoint p1, const GColor color[] , int count, GShader::TileMode tileMode) {
-    return (std::unique_ptr<GShader>) new BasicGradient(p0,p1,color, count, tileMode, mapToRadial);
+    return (std::unique_ptr<GShader>) new BasicGradient(p0,p1,color, count, tileMode, BasicGradient::kRadial);
+}
+
+std::unique_ptr<GShader> GCreateFinalRadialGradient(GPoint center, float radius, const GColor color[] , int count, GShader::TileMode tileMode) {
+    GPoint edge = GPoint::Make(center.x() + radius, center.y());
+    return (std::unique_ptr<GShader>) new BasicGradient(center, edge, color, count, tileMode, BasicGradient::kRadial);
 }
 
 std::unique_ptr<GShader> GCreateRayGradient(GPoint p0, GPoint p1, const GColor color[] , int count, GShader::TileMode tileMode) {
-    return (std::unique_ptr<GShader>) new BasicGradient(p0,p1,color, count, tileMode, mapToRadialRays);
+    return (std::unique_ptr<GShader>) new BasicGradient(p0,p1,color, count, tileMode, BasicGradient::kRays);
 }
\ No newline at end of file
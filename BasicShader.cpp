@@ -2,6 +2,10 @@
 #include "GBitmap.h"
 #include "GMatrix.h"
 #include "GPoint.h"
+#include "RowMapper.h"
+#include "MathUtil.h"
+#include "BitmapSampling.h"
+#include "MipMap.h"
 #include <iostream>
 
 
@@ -9,98 +13,119 @@ class BasicShader : public GShader {
 
 public:
 
-    BasicShader (const GBitmap& bitmap, const GMatrix& localMatrix, GShader::TileMode tileMode) {
+    BasicShader (const GBitmap& bitmap, const GMatrix& localMatrix, GShader::TileMode tileMode)
+    : mipmap(bitmap) {
         lm = localMatrix;
         bm = bitmap;
         this->tileMode = tileMode;
     }
 
+    /**
+     * @brief Scans the bitmap the first time it is asked, since a shader made for a single draw
+     * may never be.
+     */
     bool isOpaque() {
-        return false;
+        if (!opaqueKnown) {
+            opaque = isBitmapOpaque(mipmap.level(0));
+            opaqueKnown = true;
+        }
+        return opaque;
+    }
+
+    bool canShadeConcurrently() {
+        return true;
     }
 
+    /**
+     * @brief Inverts the CTM and local matrix into a map from device to bitmap pixels, and picks
+     * the row procedure for the kind of map it is. Drawn smaller than it is, the bitmap is
+     * sampled from the mip level nearest the size it is drawn at.
+     */
     bool setContext(const GMatrix& ctm) {
-        GMatrix finalMatrix = GMatrix::Concat(
-            GMatrix::Concat(ctm,lm),
-            GMatrix( bm.width(), 0, 0, 0, bm.height(), 0)
-        );
-        return(finalMatrix.invert(&tm));
+        if (!GMatrix::Concat(ctm, lm).invert(&inverse)) {
+            return false;
+        }
+        int level = (int) MipMap::levelFor(inverse);
+        bm = mipmap.level(level);
+        if (level > 0) {
+            inverse = mipmap.levelMatrix(level, inverse);
+        }
+        if (inverse[GMatrix::KX] != 0 || inverse[GMatrix::KY] != 0) {
+            matrixKind = kAffine;
+        } else if (inverse[GMatrix::SX] == 1 && inverse[GMatrix::SY] == 1) {
+            matrixKind = kTranslate;
+        } else {
+            matrixKind = kScale;
+        }
+        return true;
     }
 
     void shadeRow(int x, int y, int count, GPixel row[]) {
-        GPoint pointSrc[count];
-        GPoint pointDst[count];
-        for (int i = 0; i < count; i++) {
-            pointSrc[i] = GPoint::Make(x + i + 0.5, y + 0.5);
-        }  
-        tm.mapPoints(pointDst,pointSrc,count);
-
-       for (int i = 0; i < count; i++) {
-            float xMapped = pointDst[i].x();
-            float yMapped = pointDst[i].y();
-            
-            switch (tileMode) {
+        switch (tileMode) {
             default:
             case GShader::kClamp:
-                if (xMapped > 1) {
-                    xMapped = 1;
-                }
-                if (xMapped < 0) {
-                    xMapped = 0;
-                }
-                if (yMapped > 1) {
-                    yMapped = 1;
-                }
-                if (yMapped < 0) {
-                    yMapped = 0;
-                }
+                shadeTiledRow<GShader::kClamp>(x, y, count, row);
                 break;
             case GShader::kRepeat:
-                xMapped = xMapped-floor(xMapped);
-                yMapped = yMapped-floor(yMapped);
+                shadeTiledRow<GShader::kRepeat>(x, y, count, row);
                 break;
             case GShader::kMirror:
-                xMapped *= 0.5;
-                xMapped = xMapped-floor(xMapped);
-                xMapped *= 2;
-                yMapped *= 0.5;
-                yMapped = yMapped-floor(yMapped);
-                yMapped *= 2;
-                if (xMapped > 1) {
-                    xMapped = 2 - xMapped;
-                }
-                if (yMapped > 1) {
-                    yMapped = 2 - yMapped;
-                }
-        }   
-            
-            //printf("<%d,%d>", xMapped, yMapped);
-            int xLoc = floor(xMapped * bm.width());
-            int yLoc = floor(yMapped * bm.height());
-            
-            // if (xLoc > bm.width() || yLoc > bm.height()) {
-            //     printf("\n<%d,%d>", xLoc, yLoc);
-            //     printf("{%d,%d}", bm.width(), bm.height());
-            //     std::cout << std::endl;
-            // }
-
-            assert(xLoc < bm.width());
-            assert(yLoc < bm.height());
-            row[i] = *bm.getAddr(xLoc,yLoc);
-           
+                shadeTiledRow<GShader::kMirror>(x, y, count, row);
+                break;
         }
-        
     }
-    
 
 private:
 
-    GMatrix tm;
+    // What the device to bitmap map does, from cheapest to shade to dearest.
+    enum MatrixKind {
+        kTranslate,
+        kScale,
+        kAffine,
+    };
+
+    GMatrix inverse;
     GMatrix lm;
+    MipMap mipmap;
     GBitmap bm;
+    bool opaque = false;
+    bool opaqueKnown = false;
+    MatrixKind matrixKind = kAffine;
 
     GShader::TileMode tileMode;
 
+    template <GShader::TileMode TileMode> void shadeTiledRow(int x, int y, int count, GPixel row[]) {
+        float cx = x + 0.5f;
+        float cy = y + 0.5f;
+        float startX = (inverse[GMatrix::SX] * cx) + inverse[GMatrix::TX];
+        float endX = (inverse[GMatrix::SX] * (cx + count)) + inverse[GMatrix::TX];
+
+        if (matrixKind == kTranslate) {
+            const GPixel* src = bm.getAddr(0, tileTexelCoordinate<TileMode>(cy + inverse[GMatrix::TY], bm.height()));
+            if (std::abs(startX) < kMaxFixedTexelCoordinate) {
+                copyTiledRow<TileMode>(src, bm.width(), x + GFloorToInt(0.5f + inverse[GMatrix::TX]), count, row);
+                return;
+            }
+        } else if (matrixKind == kScale && std::abs(startX) < kMaxFixedTexelCoordinate && std::abs(endX) < kMaxFixedTexelCoordinate) {
+            const GPixel* src = bm.getAddr(0, tileTexelCoordinate<TileMode>((inverse[GMatrix::SY] * cy) + inverse[GMatrix::TY], bm.height()));
+            // Stepped from the center of device column 0, so a pixel samples the same texel
+            // whichever span it is shaded in.
+            GFixed dx = doubleToFixed(inverse[GMatrix::SX]);
+            GFixed fx = stepFixed((0.5 * inverse[GMatrix::SX]) + inverse[GMatrix::TX], dx, x);
+            for (int i = 0; i < count; i++) {
+                row[i] = src[tileTexel<TileMode>(fx >> 16, bm.width())];
+                fx += dx;
+            }
+            return;
+        }
+
+        mapRow(inverse, x, y, count, [&](int i, float xMapped, float yMapped) {
+            int column = tileTexelCoordinate<TileMode>(xMapped, bm.width());
+            int r = tileTexelCoordinate<TileMode>(yMapped, bm.height());
+            row[i] = *bm.getAddr(column, r);
+        });
+    }
+
 };
 
 
@@ -0,0 +1,291 @@
+#include "GShader.h"
+#include "GBitmap.h"
+#include "GMatrix.h"
+#include "GPoint.h"
+#include "RowMapper.h"
+#include "MathUtil.h"
+#include "BitmapSampling.h"
+#include "MipMap.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * @brief A bitmap shader that blends the four bitmap pixels around each sample, weighted by how
+ * near the sample is to each of their centers.
+ *
+ * Weights are 8-bit fixed point: a sample a fraction f of the way from one pixel center to the
+ * next weighs them (256 - 256f) and 256f. Every channel of a pixel is blended with the same
+ * weights and rounded down, so premultiplied pixels stay premultiplied.
+ *
+ * Drawn smaller than it is, the bitmap is sampled from the mip level nearest the size it is drawn
+ * at or, in MipMap::kLinear mode, from the two levels either side of that size, blended.
+ */
+class BilerpShader : public GShader {
+
+public:
+
+    BilerpShader (const GBitmap& bitmap, const GMatrix& localMatrix, GShader::TileMode tileMode, MipMap::Mode mipMode)
+    : mipmap(bitmap) {
+        lm = localMatrix;
+        this->tileMode = tileMode;
+        this->mipMode = mipMode;
+    }
+
+    /**
+     * @brief Scans the bitmap the first time it is asked, since a shader made for a single draw
+     * may never be.
+     */
+    bool isOpaque() {
+        if (!opaqueKnown) {
+            opaque = isBitmapOpaque(mipmap.level(0));
+            opaqueKnown = true;
+        }
+        return opaque;
+    }
+
+    bool canShadeConcurrently() {
+        return true;
+    }
+
+    /**
+     * @brief Inverts the CTM and local matrix into a map from device to bitmap pixels, and picks
+     * the mip levels to sample and the row procedure for each.
+     */
+    bool setContext(const GMatrix& ctm) {
+        GMatrix inverse;
+        if (!GMatrix::Concat(ctm, lm).invert(&inverse)) {
+            return false;
+        }
+        float level = mipMode == MipMap::kNone ? 0 : MipMap::levelFor(inverse);
+        int finer = std::min((int) level, mipmap.levelCount() - 1);
+        setLevel(levels[0], finer, inverse);
+
+        coarserWeight = 0;
+        if (mipMode == MipMap::kLinear && finer + 1 < mipmap.levelCount()) {
+            coarserWeight = std::min(255, (int) ((level - finer) * 256));
+            if (coarserWeight > 0) {
+                setLevel(levels[1], finer + 1, inverse);
+            }
+        }
+        return true;
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) {
+        shadeLevelRow(levels[0], x, y, count, row);
+        if (coarserWeight == 0) {
+            return;
+        }
+
+        const int kBlock = 64;
+        GPixel coarser[kBlock];
+        for (int start = 0; start < count; start += kBlock) {
+            int n = std::min(kBlock, count - start);
+            shadeLevelRow(levels[1], x + start, y, n, coarser);
+            GPixel* finer = row + start;
+            for (int i = 0; i < n; i++) {
+                finer[i] = filter(finer[i], coarser[i], finer[i], coarser[i], coarserWeight, 0);
+            }
+        }
+    }
+
+private:
+
+    // What the device to bitmap map does, from cheapest to shade to dearest.
+    enum MatrixKind {
+        kIntegerTranslate,
+        kScale,
+        kAffine,
+    };
+
+    // One mip level being sampled: its pixels, the map from device pixels to them, and the row
+    // procedure that map allows.
+    struct Level {
+        GBitmap bitmap;
+        GMatrix inverse;
+        MatrixKind matrixKind = kAffine;
+    };
+
+    GMatrix lm;
+    MipMap mipmap;
+    bool opaque = false;
+    bool opaqueKnown = false;
+
+    Level levels[2];
+    int coarserWeight = 0;
+
+    GShader::TileMode tileMode;
+    MipMap::Mode mipMode;
+
+    /**
+     * @brief Points level at mip level index, given the map from device pixels to the bitmap. A
+     * shift by whole pixels lands every sample on a pixel center, where filtering would give
+     * back that pixel, so it is a plain copy.
+     */
+    void setLevel(Level& level, int index, const GMatrix& inverse) {
+        level.bitmap = mipmap.level(index);
+        level.inverse = index > 0 ? mipmap.levelMatrix(index, inverse) : inverse;
+
+        const GMatrix& m = level.inverse;
+        float tx = m[GMatrix::TX];
+        float ty = m[GMatrix::TY];
+        if (m[GMatrix::KX] != 0 || m[GMatrix::KY] != 0) {
+            level.matrixKind = kAffine;
+        } else if (m[GMatrix::SX] == 1 && m[GMatrix::SY] == 1
+                   && std::abs(tx) < kMaxFixedTexelCoordinate && std::abs(ty) < kMaxFixedTexelCoordinate
+                   && tx == std::floor(tx) && ty == std::floor(ty)) {
+            level.matrixKind = kIntegerTranslate;
+        } else {
+            level.matrixKind = kScale;
+        }
+    }
+
+    void shadeLevelRow(const Level& level, int x, int y, int count, GPixel row[]) {
+        switch (tileMode) {
+            default:
+            case GShader::kClamp:
+                shadeTiledRow<GShader::kClamp>(level, x, y, count, row);
+                break;
+            case GShader::kRepeat:
+                shadeTiledRow<GShader::kRepeat>(level, x, y, count, row);
+                break;
+            case GShader::kMirror:
+                shadeTiledRow<GShader::kMirror>(level, x, y, count, row);
+                break;
+        }
+    }
+
+    /**
+     * @brief Blends the pixels left and right of a sample on the row above it, p00 and p01, and
+     * on the row below it, p10 and p11, by the weights wx and wy of the right and lower pixels.
+     */
+    static GPixel filter(GPixel p00, GPixel p01, GPixel p10, GPixel p11, int wx, int wy) {
+#if defined(__SSE2__)
+        return filterPairs(_mm_unpacklo_epi32(_mm_cvtsi32_si128(p00), _mm_cvtsi32_si128(p01)),
+                           _mm_unpacklo_epi32(_mm_cvtsi32_si128(p10), _mm_cvtsi32_si128(p11)),
+                           _mm_set1_epi16(256 - wy), _mm_set1_epi16(wy), wx);
+#else
+        GPixel result = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            unsigned left = ((((p00 >> shift) & 0xFF) * (256 - wy)) + (((p10 >> shift) & 0xFF) * wy)) >> 8;
+            unsigned right = ((((p01 >> shift) & 0xFF) * (256 - wy)) + (((p11 >> shift) & 0xFF) * wy)) >> 8;
+            result |= (((left * (256 - wx)) + (right * wx)) >> 8) << shift;
+        }
+        return result;
+#endif
+    }
+
+#if defined(__SSE2__)
+    /**
+     * @brief filter() for the left and right pixels already side by side in the low 64 bits of
+     * top and bottom, with the row weights already spread across every 16-bit lane, so a row that
+     * keeps them can set them up once.
+     */
+    static GPixel filterPairs(__m128i top, __m128i bottom, __m128i aboveWeight, __m128i belowWeight, int wx) {
+        const __m128i zero = _mm_setzero_si128();
+
+        // The left pixel's channels in the low four lanes, the right pixel's in the high four.
+        top = _mm_unpacklo_epi8(top, zero);
+        bottom = _mm_unpacklo_epi8(bottom, zero);
+
+        // Each sum is at most 255 * 256, so it fits in an unsigned 16-bit lane.
+        __m128i column = _mm_add_epi16(_mm_mullo_epi16(top, aboveWeight), _mm_mullo_epi16(bottom, belowWeight));
+        column = _mm_srli_epi16(column, 8);
+
+        // wx in every lane, then 256 - wx in the left pixel's lanes, as ~wx + 257.
+        __m128i weights = _mm_set1_epi16(wx);
+        weights = _mm_add_epi16(_mm_xor_si128(weights, _mm_setr_epi16(-1, -1, -1, -1, 0, 0, 0, 0)),
+                                _mm_setr_epi16(257, 257, 257, 257, 0, 0, 0, 0));
+
+        __m128i weighted = _mm_mullo_epi16(column, weights);
+        __m128i sum = _mm_srli_epi16(_mm_add_epi16(weighted, _mm_srli_si128(weighted, 8)), 8);
+        return _mm_cvtsi128_si32(_mm_packus_epi16(sum, zero));
+    }
+#endif
+
+    /**
+     * @brief Returns the 8-bit weight of the pixel after p, for p measured from pixel centers.
+     */
+    static int fractionWeight(float p) {
+        return std::min(255, (int) ((p - std::floor(p)) * 256));
+    }
+
+    template <GShader::TileMode TileMode>
+    static void shadeTiledRow(const Level& level, int x, int y, int count, GPixel row[]) {
+        const GBitmap& bm = level.bitmap;
+        const GMatrix& inverse = level.inverse;
+        const int width = bm.width();
+        const int height = bm.height();
+        float cx = x + 0.5f;
+        float cy = y + 0.5f;
+
+        if (level.matrixKind == kIntegerTranslate) {
+            int top = y + (int) inverse[GMatrix::TY];
+            copyTiledRow<TileMode>(bm.getAddr(0, tileTexel<TileMode>(top, height)), width,
+                                   x + (int) inverse[GMatrix::TX], count, row);
+            return;
+        }
+
+        // Samples are taken from the center of pixel 0, so shift them half a pixel back.
+        float startX = (inverse[GMatrix::SX] * cx) + inverse[GMatrix::TX] - 0.5f;
+        float endX = (inverse[GMatrix::SX] * (cx + count)) + inverse[GMatrix::TX] - 0.5f;
+        if (level.matrixKind == kScale && std::abs(startX) < kMaxFixedTexelCoordinate && std::abs(endX) < kMaxFixedTexelCoordinate) {
+            float v = (inverse[GMatrix::SY] * cy) + inverse[GMatrix::TY] - 0.5f;
+            int top = floorTexelCoordinate(v);
+            int wy = fractionWeight(v);
+            const GPixel* above = bm.getAddr(0, tileTexel<TileMode>(top, height));
+            const GPixel* below = bm.getAddr(0, tileTexel<TileMode>(top + 1, height));
+
+            // Stepped from device column 0, so a pixel gets the same pixels and weights whichever
+            // span it is shaded in.
+            GFixed dx = doubleToFixed(inverse[GMatrix::SX]);
+            GFixed fx = stepFixed((0.5 * inverse[GMatrix::SX]) + inverse[GMatrix::TX] - 0.5, dx, x);
+#if defined(__SSE2__)
+            const __m128i aboveWeight = _mm_set1_epi16(256 - wy);
+            const __m128i belowWeight = _mm_set1_epi16(wy);
+#endif
+            for (int i = 0; i < count; i++) {
+                int left = fx >> 16;
+                int wx = (fx >> 8) & 0xFF;
+                fx += dx;
+
+                // Inside the bitmap the two columns are neighbours, and no tile mode moves them.
+                if ((unsigned) left < (unsigned) (width - 1)) {
+#if defined(__SSE2__)
+                    row[i] = filterPairs(_mm_loadl_epi64((const __m128i*) (above + left)),
+                                         _mm_loadl_epi64((const __m128i*) (below + left)),
+                                         aboveWeight, belowWeight, wx);
+#else
+                    row[i] = filter(above[left], above[left + 1], below[left], below[left + 1], wx, wy);
+#endif
+                    continue;
+                }
+                int c0 = tileTexel<TileMode>(left, width);
+                int c1 = tileTexel<TileMode>(left + 1, width);
+                row[i] = filter(above[c0], above[c1], below[c0], below[c1], wx, wy);
+            }
+            return;
+        }
+
+        mapRow(inverse, x, y, count, [&](int i, float xMapped, float yMapped) {
+            float u = xMapped - 0.5f;
+            float v = yMapped - 0.5f;
+            int left = floorTexelCoordinate(u);
+            int top = floorTexelCoordinate(v);
+            int c0 = tileTexel<TileMode>(left, width);
+            int c1 = tileTexel<TileMode>(left + 1, width);
+            const GPixel* above = bm.getAddr(0, tileTexel<TileMode>(top, height));
+            const GPixel* below = bm.getAddr(0, tileTexel<TileMode>(top + 1, height));
+            row[i] = filter(above[c0], above[c1], below[c0], below[c1], fractionWeight(u), fractionWeight(v));
+        });
+    }
+
+};
+
+
+std::unique_ptr<GShader> GCreateBilerpShader(const GBitmap& bitmap, const GMatrix& localMatrix, GShader::TileMode tileMode,
+                                             MipMap::Mode mipMode) {
+    return (std::unique_ptr<GShader>) new BilerpShader(bitmap, localMatrix, tileMode, mipMode);
+}
@@ -0,0 +1,113 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef BitmapSampling_DEFINED
+#define BitmapSampling_DEFINED
+
+#include "GBitmap.h"
+#include "GMath.h"
+#include "GPixel.h"
+#include "GShader.h"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief Past this many pixels from the origin, stepping across a bitmap in 16.16 fixed point
+ * could overflow.
+ */
+static constexpr float kMaxFixedTexelCoordinate = 16384;
+
+/**
+ * @brief Returns whether every pixel of bitmap is opaque. Every tile mode only ever samples
+ * pixels of the bitmap, so its pixels decide whether a bitmap shader is opaque. A bitmap flagged
+ * opaque is trusted, since GBitmap checks the flag against its pixels; otherwise the pixels are
+ * scanned until one is not opaque.
+ */
+static inline bool isBitmapOpaque(const GBitmap& bitmap) {
+    if (bitmap.isOpaque()) {
+        return true;
+    }
+    for (int y = 0; y < bitmap.height(); y++) {
+        const GPixel* row = bitmap.getAddr(0, y);
+        for (int x = 0; x < bitmap.width(); x++) {
+            if (GPixel_GetA(row[x]) != 255) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Brings a column or row index of a bitmap size pixels across back into the bitmap.
+ */
+template <GShader::TileMode TileMode> static inline int tileTexel(int i, int size) {
+    switch (TileMode) {
+        default:
+        case GShader::kClamp:
+            return std::max(0, std::min(i, size - 1));
+        case GShader::kRepeat:
+            i %= size;
+            return i < 0 ? i + size : i;
+        case GShader::kMirror:
+            i %= 2 * size;
+            if (i < 0) {
+                i += 2 * size;
+            }
+            return i < size ? i : ((2 * size) - 1) - i;
+    }
+}
+
+/**
+ * @brief Returns floor(p), with coordinates too large for an int pinned first; every tile mode
+ * treats them alike.
+ */
+static inline int floorTexelCoordinate(float p) {
+    return GFloorToInt(std::max(-1e9f, std::min(p, 1e9f)));
+}
+
+/**
+ * @brief Returns the bitmap pixel that covers p along one axis, tiled.
+ */
+template <GShader::TileMode TileMode> static inline int tileTexelCoordinate(float p, int size) {
+    return tileTexel<TileMode>(floorTexelCoordinate(p), size);
+}
+
+/**
+ * @brief Shades a row that only moves across the bitmap row src, width pixels across, by whole
+ * pixels, starting at column left. Clamped rows are a copy with the edge pixels repeated on
+ * either side, and repeating rows are copied a period at a time.
+ */
+template <GShader::TileMode TileMode>
+static inline void copyTiledRow(const GPixel src[], int width, int left, int count, GPixel row[]) {
+    switch (TileMode) {
+        case GShader::kClamp: {
+            int before = std::min(count, std::max(0, -left));
+            std::fill_n(row, before, src[0]);
+            int copied = std::max(0, std::min(count, width - left) - before);
+            std::memcpy(row + before, src + left + before, copied * sizeof(GPixel));
+            std::fill_n(row + before + copied, count - before - copied, src[width - 1]);
+            return;
+        }
+        case GShader::kRepeat: {
+            int column = tileTexel<GShader::kRepeat>(left, width);
+            while (count > 0) {
+                int n = std::min(count, width - column);
+                std::memcpy(row, src + column, n * sizeof(GPixel));
+                row += n;
+                count -= n;
+                column = 0;
+            }
+            return;
+        }
+        default:
+            for (int i = 0; i < count; i++) {
+                row[i] = src[tileTexel<TileMode>(left + i, width)];
+            }
+            return;
+    }
+}
+
+#endif
@@ -43,6 +43,24 @@ static inline GPixel interpolate(GColor c1, GColor c2, float w) {
     
 }
 
+/**
+ * @brief Returns the pixel that lies the given fraction (out of 255) of the way from one pixel to another.
+ * Used to apply partial pixel coverage to the result of a blend.
+ * 
+ * @param from the pixel at alpha 0.
+ * @param to the pixel at alpha 255.
+ * @param alpha how far to move towards the second pixel.
+ * @return GPixel 
+ */
+static inline GPixel lerpPixel(GPixel from, GPixel to, unsigned alpha) {
+    unsigned invAlpha = 255 - alpha;
+    int a = div255((GPixel_GetA(to) * alpha) + (GPixel_GetA(from) * invAlpha));
+    int r = div255((GPixel_GetR(to) * alpha) + (GPixel_GetR(from) * invAlpha));
+    int g = div255((GPixel_GetG(to) * alpha) + (GPixel_GetG(from) * invAlpha));
+    int b = div255((GPixel_GetB(to) * alpha) + (GPixel_GetB(from) * invAlpha));
+    return GPixel_PackARGB(a,r,g,b);
+}
+
 /**
  * @brief Reassigns the dst pixel to blend with the src pixel using a source-over blending algorithm.
  * 
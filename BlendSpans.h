@@ -0,0 +1,314 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef BlendSpans_DEFINED
+#define BlendSpans_DEFINED
+
+#include "GBlendMode.h"
+#include "GPixel.h"
+#include "BlendFunctions.h"
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+typedef void (*BlendSpanProc) (const GPixel src[], GPixel dst[], int count);
+typedef void (*BlendSolidSpanProc) (GPixel src, GPixel dst[], int count);
+
+/**
+ * @brief Blends whole spans of pixels in one of the blend modes. span takes a source pixel for
+ * every destination pixel, and solidSpan blends a single source pixel across the span. pixel is
+ * the matching one-pixel function from BlendFunctions.h.
+ */
+struct BlendSpanProcs {
+    BlendSpanProc span;
+    BlendSolidSpanProc solidSpan;
+    void (*pixel) (GPixel&, GPixel&);
+};
+
+#if defined(__SSE2__)
+
+/**
+ * @brief The blend modes worked on two unpacked pixels at a time, each channel in its own 16-bit
+ * lane. Every mode is the same sum of products as its scalar function in BlendFunctions.h, with
+ * the same rounding, so the two agree bit for bit on premultiplied pixels.
+ */
+namespace BlendLanes {
+
+    // Exactly div255() on every lane, which holds since the numerators never pass 255 * 255.
+    static inline __m128i div255(__m128i x) {
+        x = _mm_add_epi16(x, _mm_set1_epi16(0x80));
+        x = _mm_add_epi16(x, _mm_srli_epi16(x, 8));
+        return _mm_srli_epi16(x, 8);
+    }
+
+    // Copies each pixel's alpha into all four of its lanes.
+    static inline __m128i alpha(__m128i p) {
+        p = _mm_shufflelo_epi16(p, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm_shufflehi_epi16(p, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    static inline __m128i inv(__m128i x) {
+        return _mm_sub_epi16(_mm_set1_epi16(255), x);
+    }
+
+    static inline __m128i mul(__m128i a, __m128i b) {
+        return _mm_mullo_epi16(a, b);
+    }
+
+    // With OpaqueSrc the source's alpha is known to be 255, and the modes it touches drop the
+    // terms it cancels. That changes nothing, since div255(255 * x) == x and div255(0) == 0.
+
+    struct Clear {
+        template <bool OpaqueSrc> static __m128i blend(__m128i, __m128i) { return _mm_setzero_si128(); }
+    };
+    struct Src {
+        template <bool OpaqueSrc> static __m128i blend(__m128i s, __m128i) { return s; }
+    };
+    struct Dst {
+        template <bool OpaqueSrc> static __m128i blend(__m128i, __m128i d) { return d; }
+    };
+    struct SrcOver {
+        template <bool OpaqueSrc> static __m128i blend(__m128i s, __m128i d) {
+            if (OpaqueSrc) {
+                return s;
+            }
+            return _mm_add_epi16(s, div255(mul(inv(alpha(s)), d)));
+        }
+    };
+    struct DstOver {
+        template <bool OpaqueSrc> static __m128i blend(__m128i s, __m128i d) {
+            return _mm_add_epi16(d, div255(mul(inv(alpha(d)), s)));
+        }
+    };
+    struct SrcIn {
+        template <bool OpaqueSrc> static __m128i blend(__m128i s, __m128i d) { return div255(mul(alpha(d), s)); }
+    };
+    struct DstIn {
+        template <bool OpaqueSrc> static __m128i blend(__m128i s, __m128i d) {
+            if (OpaqueSrc) {
+                return d;
+            }
+            return div255(mul(alpha(s), d));
+        }
+    };
+    struct SrcOut {
+        template <bool OpaqueSrc> static __m128i blend(__m128i s, __m128i d) { return div255(mul(inv(alpha(d)), s)); }
+    };
+    struct DstOut {
+        template <bool OpaqueSrc> static __m128i blend(__m128i s, __m128i d) {
+            if (OpaqueSrc) {
+                return _mm_setzero_si128();
+            }
+            return div255(mul(inv(alpha(s)), d));
+        }
+    };
+    struct SrcATop {
+        template <bool OpaqueSrc> static __m128i blend(__m128i s, __m128i d) {
+            if (OpaqueSrc) {
+                return SrcIn::blend<true>(s, d);
+            }
+            return div255(_mm_add_epi16(mul(alpha(d), s), mul(inv(alpha(s)), d)));
+        }
+    };
+    struct DstATop {
+        template <bool OpaqueSrc> static __m128i blend(__m128i s, __m128i d) {
+            if (OpaqueSrc) {
+                return DstOver::blend<true>(s, d);
+            }
+            return div255(_mm_add_epi16(mul(alpha(s), d), mul(inv(alpha(d)), s)));
+        }
+    };
+    struct Xor {
+        template <bool OpaqueSrc> static __m128i blend(__m128i s, __m128i d) {
+            if (OpaqueSrc) {
+                return SrcOut::blend<true>(s, d);
+            }
+            return div255(_mm_add_epi16(mul(inv(alpha(s)), d), mul(inv(alpha(d)), s)));
+        }
+    };
+
+}
+
+#endif
+
+/**
+ * @brief Blends count source pixels into count destination pixels, four at a time where SSE2 is
+ * available and one at a time through the scalar function otherwise. Every combination of mode
+ * and source opacity is its own instantiation, so the mode's arithmetic is inlined into the loop.
+ */
+template <typename Lanes, void (*Pixel)(GPixel&, GPixel&), bool OpaqueSrc>
+static void blendSpan(const GPixel src[], GPixel dst[], int count) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*) &src[i]);
+        __m128i d = _mm_loadu_si128((const __m128i*) &dst[i]);
+        __m128i lo = Lanes::template blend<OpaqueSrc>(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i hi = Lanes::template blend<OpaqueSrc>(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128((__m128i*) &dst[i], _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; i++) {
+        GPixel s = src[i];
+        Pixel(s, dst[i]);
+    }
+}
+
+/**
+ * @brief Blends one source pixel into count destination pixels.
+ */
+template <typename Lanes, void (*Pixel)(GPixel&, GPixel&), bool OpaqueSrc>
+static void blendSolidSpan(GPixel src, GPixel dst[], int count) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i s = _mm_unpacklo_epi8(_mm_set1_epi32((int) src), zero);
+    for (; i + 4 <= count; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i*) &dst[i]);
+        __m128i lo = Lanes::template blend<OpaqueSrc>(s, _mm_unpacklo_epi8(d, zero));
+        __m128i hi = Lanes::template blend<OpaqueSrc>(s, _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128((__m128i*) &dst[i], _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; i++) {
+        Pixel(src, dst[i]);
+    }
+}
+
+/**
+ * @brief Src and Clear ignore the destination, so a solid source is just stored.
+ */
+static void storeSolidSpan(GPixel src, GPixel dst[], int count) {
+    std::fill_n(dst, count, src);
+}
+
+static void clearSolidSpan(GPixel, GPixel dst[], int count) {
+    std::fill_n(dst, count, 0);
+}
+
+/**
+ * @brief Multiplies two premultiplied pixels channel by channel, each channel div255(a * b), as
+ * when one shader's output is tinted by another's.
+ */
+static inline GPixel modulatePixel(GPixel a, GPixel b) {
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i pa = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int) a), zero);
+    __m128i pb = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int) b), zero);
+    return _mm_cvtsi128_si32(_mm_packus_epi16(BlendLanes::div255(BlendLanes::mul(pa, pb)), zero));
+#else
+    return GPixel_PackARGB(div255(GPixel_GetA(a) * GPixel_GetA(b)), div255(GPixel_GetR(a) * GPixel_GetR(b)),
+                           div255(GPixel_GetG(a) * GPixel_GetG(b)), div255(GPixel_GetB(a) * GPixel_GetB(b)));
+#endif
+}
+
+/**
+ * @brief Multiplies count pixels of dst by the pixels of src, as modulatePixel() does, four at a
+ * time where SSE2 is available.
+ */
+static inline void modulateSpan(const GPixel src[], GPixel dst[], int count) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*) &src[i]);
+        __m128i d = _mm_loadu_si128((const __m128i*) &dst[i]);
+        __m128i lo = BlendLanes::div255(BlendLanes::mul(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero)));
+        __m128i hi = BlendLanes::div255(BlendLanes::mul(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero)));
+        _mm_storeu_si128((__m128i*) &dst[i], _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = modulatePixel(src[i], dst[i]);
+    }
+}
+
+#if defined(__SSE2__)
+#define BLEND_LANES(lanes) BlendLanes::lanes
+#else
+#define BLEND_LANES(lanes) void
+#endif
+
+#define BLEND_SPAN_PROCS(lanes, pixel, opaque) { \
+    blendSpan<BLEND_LANES(lanes), pixel, opaque>, \
+    blendSolidSpan<BLEND_LANES(lanes), pixel, opaque>, \
+    pixel \
+}
+
+#define BLEND_STORE_SPAN_PROCS(lanes, pixel, solidSpan, opaque) { \
+    blendSpan<BLEND_LANES(lanes), pixel, opaque>, \
+    solidSpan, \
+    pixel \
+}
+
+#define BLEND_SPAN_PROCS_FOR_ALL_MODES(opaque) { \
+    BLEND_STORE_SPAN_PROCS(Clear, clearBlend, clearSolidSpan, opaque), \
+    BLEND_STORE_SPAN_PROCS(Src, srcBlend, storeSolidSpan, opaque), \
+    BLEND_SPAN_PROCS(Dst, dstBlend, opaque), \
+    BLEND_SPAN_PROCS(SrcOver, srcOverBlend, opaque), \
+    BLEND_SPAN_PROCS(DstOver, dstOverBlend, opaque), \
+    BLEND_SPAN_PROCS(SrcIn, srcInBlend, opaque), \
+    BLEND_SPAN_PROCS(DstIn, dstInBlend, opaque), \
+    BLEND_SPAN_PROCS(SrcOut, srcOutBlend, opaque), \
+    BLEND_SPAN_PROCS(DstOut, dstOutBlend, opaque), \
+    BLEND_SPAN_PROCS(SrcATop, srcATopBlend, opaque), \
+    BLEND_SPAN_PROCS(DstATop, dstATopBlend, opaque), \
+    BLEND_SPAN_PROCS(Xor, xorBlend, opaque), \
+}
+
+/**
+ * @brief Returns the span blenders for the given blend mode. Draws look them up once, before
+ * their first span.
+ *
+ * @param opaqueSource true if every source pixel is known to have an alpha of 255.
+ */
+static inline const BlendSpanProcs& getBlendSpanProcs(GBlendMode blendMode, bool opaqueSource = false) {
+    // In GBlendMode's declaration order.
+    static const BlendSpanProcs procs[2][12] = {
+        BLEND_SPAN_PROCS_FOR_ALL_MODES(false),
+        BLEND_SPAN_PROCS_FOR_ALL_MODES(true),
+    };
+    return procs[opaqueSource][(int) blendMode];
+}
+
+#undef BLEND_SPAN_PROCS_FOR_ALL_MODES
+#undef BLEND_STORE_SPAN_PROCS
+#undef BLEND_SPAN_PROCS
+#undef BLEND_LANES
+
+/**
+ * @brief Returns the cheapest blend mode that gives the same pixels as blendMode for a source
+ * known to be opaque (alpha 255 everywhere) or transparent (every pixel 0). kDst means the draw
+ * would leave every pixel as it is, and can be skipped.
+ */
+static inline GBlendMode reduceBlendMode(GBlendMode blendMode, bool opaqueSource, bool transparentSource) {
+    if (opaqueSource && blendMode == GBlendMode::kSrcOver) {
+        return GBlendMode::kSrc;
+    }
+    if (transparentSource) {
+        switch (blendMode) {
+            case GBlendMode::kSrcOver:
+            case GBlendMode::kDstOver:
+            case GBlendMode::kDstOut:
+            case GBlendMode::kSrcATop:
+            case GBlendMode::kXor:
+                return GBlendMode::kDst;
+            case GBlendMode::kSrc:
+            case GBlendMode::kSrcIn:
+            case GBlendMode::kDstIn:
+            case GBlendMode::kSrcOut:
+            case GBlendMode::kDstATop:
+                return GBlendMode::kClear;
+            default:
+                break;
+        }
+    }
+    return blendMode;
+}
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef Blitter_DEFINED
+#define Blitter_DEFINED
+
+#include "GBitmap.h"
+#include "GPixel.h"
+#include "GRect.h"
+#include "GShader.h"
+#include "BlendSpans.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Where a scan converter's pixels go. A draw makes one blitter from its paint and the
+ * device, and the scan converter hands it rows of coverage without knowing how they are shaded
+ * or blended. Every span a blitter receives is already inside the canvas clip.
+ */
+class Blitter {
+
+    public:
+
+        /**
+         * @brief Fully covers the pixels [x, x + width) on row y.
+         */
+        virtual void blitH(int x, int y, int width) = 0;
+
+        /**
+         * @brief Fully covers width by height pixels with their top left at (x, y).
+         */
+        virtual void blitRect(int x, int y, int width, int height) {
+            for (int row = 0; row < height; row++) {
+                blitH(x, y + row, width);
+            }
+        }
+
+        /**
+         * @brief Partially covers a row, starting at (x, y), as runCount runs of pixels. Run i is
+         * runs[i] pixels long and covered alpha[i]/255; runs with an alpha of 0 are gaps.
+         */
+        virtual void blitAntiH(int x, int y, const uint8_t alpha[], const int runs[], int runCount) = 0;
+
+        /**
+         * @brief Covers the pixels in bounds by a mask with one alpha per pixel, rowBytes apart.
+         */
+        virtual void blitMask(const GIRect& bounds, const uint8_t mask[], size_t rowBytes) {
+            for (int y = bounds.top(); y < bounds.bottom(); y++) {
+                const uint8_t* row = mask + (y - bounds.top()) * rowBytes;
+                int width = bounds.width();
+                int i = 0;
+                while (i < width) {
+                    int runStart = i;
+                    while (i < width && row[i] == row[runStart]) {
+                        i++;
+                    }
+                    if (row[runStart] > 0) {
+                        int run = i - runStart;
+                        blitAntiH(bounds.left() + runStart, y, &row[runStart], &run, 1);
+                    }
+                }
+            }
+        }
+
+};
+
+/**
+ * @brief Blends a single color into the device.
+ */
+class SolidBlitter : public Blitter {
+
+    public:
+
+        SolidBlitter(const GBitmap& device, GPixel pixel, const BlendSpanProcs& blendProcs)
+        : device(device), pixel(pixel), blendProcs(blendProcs) {}
+
+        void blitH(int x, int y, int width) override {
+            blendProcs.solidSpan(pixel, device.getAddr(x, y), width);
+        }
+
+        void blitRect(int x, int y, int width, int height) override {
+            for (int row = 0; row < height; row++) {
+                blendProcs.solidSpan(pixel, device.getAddr(x, y + row), width);
+            }
+        }
+
+        void blitAntiH(int x, int y, const uint8_t alpha[], const int runs[], int runCount) override {
+            GPixel* dst = device.getAddr(x, y);
+            for (int i = 0; i < runCount; i++) {
+                if (alpha[i] == 255) {
+                    blendProcs.solidSpan(pixel, dst, runs[i]);
+                } else if (alpha[i] > 0) {
+                    for (int k = 0; k < runs[i]; k++) {
+                        GPixel blended = dst[k];
+                        blendProcs.pixel(pixel, blended);
+                        dst[k] = lerpPixel(dst[k], blended, alpha[i]);
+                    }
+                }
+                dst += runs[i];
+            }
+        }
+
+    private:
+
+        const GBitmap& device;
+        GPixel pixel;
+        const BlendSpanProcs& blendProcs;
+
+};
+
+/**
+ * @brief Shades each span with a shader whose context is already set, then blends it into the
+ * device. shadeBuffer must hold at least a device row of pixels.
+ */
+class ShaderBlitter : public Blitter {
+
+    public:
+
+        ShaderBlitter(const GBitmap& device, GShader* shader, const BlendSpanProcs& blendProcs, GPixel shadeBuffer[])
+        : device(device), shader(shader), blendProcs(&blendProcs), shadeBuffer(shadeBuffer) {}
+
+        /**
+         * @brief Switches to other span blenders, for a shader whose opacity changes between draws.
+         */
+        void setBlendProcs(const BlendSpanProcs& procs) {
+            blendProcs = &procs;
+        }
+
+        void blitH(int x, int y, int width) override {
+            shader->shadeRow(x, y, width, shadeBuffer);
+            blendProcs->span(shadeBuffer, device.getAddr(x, y), width);
+        }
+
+        void blitAntiH(int x, int y, const uint8_t alpha[], const int runs[], int runCount) override {
+            GPixel* dst = device.getAddr(x, y);
+            int i = 0;
+            while (i < runCount) {
+                if (alpha[i] == 0) {
+                    x += runs[i];
+                    dst += runs[i];
+                    i++;
+                    continue;
+                }
+
+                // Shade every covered run up to the next gap at once.
+                int end = i;
+                int width = 0;
+                while (end < runCount && alpha[end] > 0) {
+                    width += runs[end++];
+                }
+                shader->shadeRow(x, y, width, shadeBuffer);
+
+                const GPixel* src = shadeBuffer;
+                for (; i < end; i++) {
+                    if (alpha[i] == 255) {
+                        blendProcs->span(src, dst, runs[i]);
+                    } else {
+                        for (int k = 0; k < runs[i]; k++) {
+                            GPixel shaded = src[k];
+                            GPixel blended = dst[k];
+                            blendProcs->pixel(shaded, blended);
+                            dst[k] = lerpPixel(dst[k], blended, alpha[i]);
+                        }
+                    }
+                    src += runs[i];
+                    dst += runs[i];
+                }
+                x += width;
+            }
+        }
+
+    private:
+
+        const GBitmap& device;
+        GShader* shader;
+        const BlendSpanProcs* blendProcs;
+        GPixel* shadeBuffer;
+
+};
+
+#endif
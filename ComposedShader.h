@@ -0,0 +1,101 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef ComposedShader_DEFINED
+#define ComposedShader_DEFINED
+
+#include "GShader.h"
+#include "GBitmap.h"
+#include "GMatrix.h"
+#include "GPoint.h"
+#include "BlendFunctions.h"
+#include "BlendSpans.h"
+#include "TriBitmapShader.h"
+#include "TriColorShader.h"
+#include <algorithm>
+#include <iostream>
+
+class ComposedShader : public GShader {
+
+public:
+
+    ComposedShader (GShader* sh1, GShader* sh2) {
+        shader_1 = sh1;
+        shader_2 = sh2;
+        assert(shader_1 != nullptr && shader_2 != nullptr);
+    }
+
+    bool isOpaque() {
+        return shader_1->isOpaque() && shader_2->isOpaque();
+    }
+
+    bool canShadeConcurrently() {
+        return shader_1->canShadeConcurrently() && shader_2->canShadeConcurrently();
+    }
+
+    bool setContext(const GMatrix& ctm) {
+        return shader_1->setContext(ctm) && shader_2->setContext(ctm);
+    }
+
+    /**
+     * @brief Shades the first shader straight into row, then multiplies in the second a block at
+     * a time, so a row of any length needs only a fixed buffer.
+     */
+    void shadeRow(int x, int y, int count, GPixel row[]) {
+        shader_1->shadeRow(x, y, count, row);
+
+        const int kBlock = 64;
+        GPixel block[kBlock];
+        for (int start = 0; start < count; start += kBlock) {
+            int n = std::min(kBlock, count - start);
+            shader_2->shadeRow(x + start, y, n, block);
+            modulateSpan(block, row + start, n);
+        }
+    }
+
+private:
+
+    GShader* shader_1;
+    GShader* shader_2;
+
+};
+
+/**
+ * @brief A textured mesh triangle tinted by its vertex colors. Knowing both shaders' types, it
+ * shades the texture straight into the row and then steps the colors across it, multiplying as
+ * it goes, so a row is one pass with no buffers of its own.
+ */
+class TexturedColorShader final : public GShader {
+
+public:
+
+    TexturedColorShader (TriBitmapShader* texture, TriColorShader* colors)
+    : texture(texture), colors(colors) {}
+
+    bool isOpaque() {
+        return texture->isOpaque() && colors->isOpaque();
+    }
+
+    bool canShadeConcurrently() {
+        return texture->canShadeConcurrently() && colors->canShadeConcurrently();
+    }
+
+    bool setContext(const GMatrix& ctm) {
+        return texture->setContext(ctm) && colors->setContext(ctm);
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) {
+        texture->shadeRow(x, y, count, row);
+        colors->modulateRow(x, y, count, row);
+    }
+
+private:
+
+    TriBitmapShader* texture;
+    TriColorShader* colors;
+
+};
+
+#endif
@@ -0,0 +1,361 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef CoverageRasterizer_DEFINED
+#define CoverageRasterizer_DEFINED
+
+#include "GPoint.h"
+#include "GMath.h"
+#include "MathUtil.h"
+#include "GRect.h"
+#include "Blitter.h"
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+/**
+ * @brief One pixel's worth of outline crossings. cover is the signed height of the outline that
+ * passes through the cell, and area is that height weighted by how far into the cell the outline
+ * sits, so the cell's own coverage is (cover - area) and every pixel to its right gains cover.
+ */
+struct CoverageCell {
+    int x;
+    int y;
+    float area;
+    float cover;
+};
+
+/**
+ * @brief Accumulates analytic pixel coverage for an outline into a sparse list of cells, as
+ * font rasterizers do. Only pixels the outline actually passes through get a cell; the interior
+ * is recovered by sweeping each row and carrying the running cover from left to right.
+ */
+class CoverageRasterizer {
+
+    public:
+
+        CoverageRasterizer(int width, int height)
+        : clipWidth(width), clipHeight(height) {
+            assert(width > 0 && height > 0);
+        }
+
+        void reset() {
+            cells.clear();
+        }
+
+        bool empty() const {
+            return cells.empty();
+        }
+
+        void addLine(const GPoint& p0, const GPoint& p1) {
+            float x0 = p0.x();
+            float y0 = p0.y();
+            float x1 = p1.x();
+            float y1 = p1.y();
+
+            if (y0 == y1) {
+                return;
+            }
+
+            // Rows are independent of one another, so anything above or below the device can
+            // simply be cut away.
+            if (!clipToRange(y0, x0, y1, x1, 0, clipHeight)) {
+                return;
+            }
+
+            // Outline to the left of the device still covers the pixels to its right, so it is
+            // pinned to x = 0. Outline past the right side never reaches a visible pixel.
+            float splits[2];
+            int splitCount = 0;
+            addSplit(x0, x1, 0, splits, splitCount);
+            addSplit(x0, x1, clipWidth, splits, splitCount);
+            if (splitCount == 2 && splits[0] > splits[1]) {
+                std::swap(splits[0], splits[1]);
+            }
+
+            float prevT = 0;
+            for (int i = 0; i <= splitCount; i++) {
+                float t = i < splitCount ? splits[i] : 1;
+                if (t <= prevT) {
+                    continue;
+                }
+                float ax = interpolate(x0, x1, prevT);
+                float ay = interpolate(y0, y1, prevT);
+                float bx = interpolate(x0, x1, t);
+                float by = interpolate(y0, y1, t);
+                prevT = t;
+
+                float midX = (ax + bx) * 0.5f;
+                if (midX >= clipWidth) {
+                    continue;
+                }
+                if (midX < 0) {
+                    ax = bx = 0;
+                }
+                addClippedLine(pinToWidth(ax), ay, pinToWidth(bx), by);
+            }
+        }
+
+        void addQuad(const GPoint& a, const GPoint& b, const GPoint& c, float tolerance) {
+            float x = a.x() - (2 * b.x()) + c.x();
+            float y = a.y() - (2 * b.y()) + c.y();
+            int numSeg = GCeilToInt(sqrt(sqrt(x*x + y*y) / tolerance));
+            numSeg = std::max(numSeg, 1);
+
+            GPoint prev = a;
+            for (int i = 1; i < numSeg; i++) {
+                float t = (float) i / numSeg;
+                GPoint current = GPoint::Make(hornerEvalQuad(a.x(), b.x(), c.x(), t), hornerEvalQuad(a.y(), b.y(), c.y(), t));
+                addLine(prev, current);
+                prev = current;
+            }
+            addLine(prev, c);
+        }
+
+        void addCubic(const GPoint& a, const GPoint& b, const GPoint& c, const GPoint& d, float tolerance) {
+            float ux = a.x() - (2*b.x()) + c.x();
+            float uy = a.y() - (2*b.y()) + c.y();
+            float vx = b.x() - (2*c.x()) + d.x();
+            float vy = b.y() - (2*c.y()) + d.y();
+            float x = std::max(std::abs(ux), std::abs(vx));
+            float y = std::max(std::abs(uy), std::abs(vy));
+            int numSeg = GCeilToInt(sqrt((3.0 * sqrt(x*x + y*y)) / (4.0 * tolerance)));
+            numSeg = std::max(numSeg, 1);
+
+            GPoint prev = a;
+            for (int i = 1; i < numSeg; i++) {
+                float t = (float) i / numSeg;
+                GPoint current = GPoint::Make(hornerEvalCubic(a.x(), b.x(), c.x(), d.x(), t), hornerEvalCubic(a.y(), b.y(), c.y(), d.y(), t));
+                addLine(prev, current);
+                prev = current;
+            }
+            addLine(prev, d);
+        }
+
+        /**
+         * @brief Walks the accumulated cells row by row and calls runProc(y, left, right, alpha)
+         * for every horizontal run of constant, non-zero coverage. Adjacent runs with the same
+         * coverage are merged, so solid interiors arrive as a single run.
+         */
+        template <typename RunProc> void sweep(RunProc runProc) {
+            std::sort(cells.begin(), cells.end(), [](const CoverageCell& a, const CoverageCell& b) {
+                return a.y < b.y || (a.y == b.y && a.x < b.x);
+            });
+
+            size_t i = 0;
+            while (i < cells.size()) {
+                int y = cells[i].y;
+                float accumulated = 0;
+                int runLeft = 0;
+                int runRight = 0;
+                int runAlpha = 0;
+
+                while (i < cells.size() && cells[i].y == y) {
+                    int x = cells[i].x;
+                    float area = 0;
+                    float cover = 0;
+                    while (i < cells.size() && cells[i].y == y && cells[i].x == x) {
+                        area += cells[i].area;
+                        cover += cells[i].cover;
+                        i++;
+                    }
+
+                    emitRun(runProc, y, x, x + 1, coverageToAlpha(accumulated + cover - area), runLeft, runRight, runAlpha);
+                    accumulated += cover;
+
+                    int nextX = clipWidth;
+                    if (i < cells.size() && cells[i].y == y) {
+                        nextX = cells[i].x;
+                    }
+                    emitRun(runProc, y, x + 1, nextX, coverageToAlpha(accumulated), runLeft, runRight, runAlpha);
+                }
+
+                if (runAlpha > 0) {
+                    runProc(y, runLeft, runRight, runAlpha);
+                }
+            }
+        }
+
+        /**
+         * @brief Sweeps the accumulated cells into blitter, one blitAntiH per row, trimming the
+         * runs to clip. Gaps between the runs of a row are passed along as runs of alpha 0.
+         */
+        void sweep(Blitter& blitter, const GIRect& clip) {
+            int rowY = clip.top() - 1;
+            int rowLeft = 0;
+            int rowRight = 0;
+            auto flushRow = [&]() {
+                if (!runLengths.empty()) {
+                    blitter.blitAntiH(rowLeft, rowY, runAlphas.data(), runLengths.data(), (int) runLengths.size());
+                    runAlphas.clear();
+                    runLengths.clear();
+                }
+            };
+
+            sweep([&](int y, int left, int right, int alpha) {
+                if (y < clip.top() || y >= clip.bottom()) {
+                    return;
+                }
+                left = std::max(left, clip.left());
+                right = std::min(right, clip.right());
+                if (left >= right) {
+                    return;
+                }
+                if (y != rowY) {
+                    flushRow();
+                    rowY = y;
+                    rowLeft = left;
+                    rowRight = left;
+                }
+                if (left > rowRight) {
+                    runAlphas.push_back(0);
+                    runLengths.push_back(left - rowRight);
+                }
+                runAlphas.push_back((uint8_t) alpha);
+                runLengths.push_back(right - left);
+                rowRight = right;
+            });
+            flushRow();
+        }
+
+    private:
+
+        const int clipWidth;
+        const int clipHeight;
+
+        std::vector<CoverageCell> cells;
+
+        // The row being gathered for the blitter, kept between sweeps so they stop allocating.
+        std::vector<uint8_t> runAlphas;
+        std::vector<int> runLengths;
+
+        float pinToWidth(float x) const {
+            return std::max(0.0f, std::min((float) clipWidth, x));
+        }
+
+        static int coverageToAlpha(float coverage) {
+            coverage = std::abs(coverage);
+            if (coverage >= 1) {
+                return 255;
+            }
+            return GRoundToInt(coverage * 255);
+        }
+
+        template <typename RunProc> void emitRun(RunProc& runProc, int y, int left, int right, int alpha,
+                                                 int& runLeft, int& runRight, int& runAlpha) {
+            if (left >= right) {
+                return;
+            }
+            if (alpha == runAlpha && left == runRight) {
+                runRight = right;
+                return;
+            }
+            if (runAlpha > 0) {
+                runProc(y, runLeft, runRight, runAlpha);
+            }
+            runLeft = left;
+            runRight = right;
+            runAlpha = alpha;
+        }
+
+        //Clips the segment to lo <= v <= hi along v, moving u with it.
+        static bool clipToRange(float& v0, float& u0, float& v1, float& u1, float lo, float hi) {
+            if ((v0 <= lo && v1 <= lo) || (v0 >= hi && v1 >= hi)) {
+                return false;
+            }
+            float du = (u1 - u0) / (v1 - v0);
+            if (v0 < lo) {
+                u0 += (lo - v0) * du;
+                v0 = lo;
+            } else if (v0 > hi) {
+                u0 += (hi - v0) * du;
+                v0 = hi;
+            }
+            if (v1 < lo) {
+                u1 += (lo - v1) * du;
+                v1 = lo;
+            } else if (v1 > hi) {
+                u1 += (hi - v1) * du;
+                v1 = hi;
+            }
+            return v0 != v1;
+        }
+
+        static void addSplit(float x0, float x1, float boundary, float splits[], int& splitCount) {
+            if ((x0 < boundary && x1 > boundary) || (x0 > boundary && x1 < boundary)) {
+                splits[splitCount++] = (boundary - x0) / (x1 - x0);
+            }
+        }
+
+        void addCell(int x, int y, float area, float cover) {
+            if (x >= clipWidth) {
+                return;
+            }
+            if (!cells.empty() && cells.back().x == x && cells.back().y == y) {
+                cells.back().area += area;
+                cells.back().cover += cover;
+                return;
+            }
+            CoverageCell cell;
+            cell.x = x;
+            cell.y = y;
+            cell.area = area;
+            cell.cover = cover;
+            cells.push_back(cell);
+        }
+
+        //Assumes the segment lies within 0 <= x <= clipWidth and 0 <= y <= clipHeight.
+        void addClippedLine(float x0, float y0, float x1, float y1) {
+            float direction = 1;
+            if (y0 > y1) {
+                std::swap(x0, x1);
+                std::swap(y0, y1);
+                direction = -1;
+            }
+            float dxdy = (x1 - x0) / (y1 - y0);
+
+            int rowTop = GFloorToInt(y0);
+            int rowBottom = std::min(GCeilToInt(y1), clipHeight);
+            for (int row = rowTop; row < rowBottom; row++) {
+                float ya = std::max(y0, (float) row);
+                float yb = std::min(y1, (float) row + 1);
+                if (ya >= yb) {
+                    continue;
+                }
+                float xa = x0 + ((ya - y0) * dxdy);
+                float xb = x0 + ((yb - y0) * dxdy);
+                addRowSegment(row, xa, ya, xb, yb, direction);
+            }
+        }
+
+        //Splits a segment that stays within one row into the cells it passes through.
+        void addRowSegment(int row, float xa, float ya, float xb, float yb, float direction) {
+            if (xa > xb) {
+                std::swap(xa, xb);
+                std::swap(ya, yb);
+            }
+            int cellLeft = GFloorToInt(xa);
+            int cellRight = std::max(GCeilToInt(xb) - 1, cellLeft);
+
+            if (cellLeft == cellRight) {
+                float dy = std::abs(yb - ya) * direction;
+                float fx = ((xa + xb) * 0.5f) - cellLeft;
+                addCell(cellLeft, row, dy * fx, dy);
+                return;
+            }
+
+            float dydx = (yb - ya) / (xb - xa);
+            for (int cx = cellLeft; cx <= cellRight; cx++) {
+                float left = std::max(xa, (float) cx);
+                float right = std::min(xb, (float) cx + 1);
+                float dy = std::abs((right - left) * dydx) * direction;
+                float fx = ((left + right) * 0.5f) - cx;
+                addCell(cx, row, dy * fx, dy);
+            }
+        }
+
+};
+
+#endif
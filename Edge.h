@@ -1,60 +1,88 @@
-
 #ifndef Edge_DEFINED
 #define Edge_DEFINED
 
 #include "GPoint.h"
+#include "MathUtil.h"
+#include <algorithm>
 #include <vector>
 
+/**
+ * @brief A clipped line segment of a shape's outline, covering rows [yTop, yBottom).
+ * x holds the edge's position at the center of the current row in 16.16 fixed point, already
+ * biased by half a pixel so that rounding to a pixel column is a single shift. dx is the change
+ * in x per row.
+ */
 struct Edge{
     int yTop;
     int yBottom;
-    float yIntercept;
-    float slope;
+    GFixed x;
+    GFixed dx;
     int orientation;
 };
 
+static inline int getX(float& m, float& b, int& y) {
+    return(GRoundToInt((m * (y + 0.5)) + b));
+}
+
+// The steepest slope, in columns per row, that 16.16 fixed point holds.
+static constexpr double kMaxEdgeSlope = 32767;
+
+/**
+ * @brief Returns the 16.16 change in x per row of an edge covering rows [yTop, yBottom). Only an
+ * edge covering a single row can be flat enough to cross more columns per row than 16.16 holds,
+ * and it is never stepped within its rows, so its step is 0. Other slopes are pinned to the range.
+ */
+static inline GFixed edgeStepToFixed(double slope, int yTop, int yBottom) {
+    if (yBottom - yTop <= 1) {
+        return 0;
+    }
+    return doubleToFixed(std::max(-kMaxEdgeSlope, std::min(slope, kMaxEdgeSlope)));
+}
+
 static inline Edge makeEdge(int yTop, int yBottom, float slope, float yIntercept, int orientation) {
     struct Edge edge;
     edge.yTop = yTop;
     edge.yBottom = yBottom;
-    edge.slope = slope;
-    edge.yIntercept = yIntercept;
+    edge.x = doubleToFixed((slope * (yTop + 0.5)) + yIntercept + 0.5);
+    edge.dx = edgeStepToFixed(slope, yTop, yBottom);
     edge.orientation = orientation;
     return(edge);
 }
 
-static inline int getX(float& m, float& b, int& y) {
-    return(GRoundToInt((m * (y + 0.5)) + b));
+/**
+ * @brief Returns the pixel column the edge crosses on its current row.
+ */
+static inline int getCurrentX(const Edge& e) {
+    return(e.x >> 16);
 }
 
-static inline int getX(Edge& e, int& y) {
-    return(getX(e.slope, e.yIntercept, y));
+/**
+ * @brief Advances the edge to the next row.
+ */
+static inline void stepEdge(Edge& e) {
+    e.x = (GFixed) ((uint32_t) e.x + (uint32_t) e.dx);
 }
 
-bool compareEdgeLessThan(Edge& e1, Edge& e2) {
-    if (e1.yTop < e2.yTop) {
-        return(true);
-    }
-    
+/**
+ * @brief Advances the edge by several rows at once, landing exactly where stepping would.
+ */
+static inline void advanceEdge(Edge& e, int rows) {
+    e.x = (GFixed) ((uint32_t) e.x + (uint32_t) ((int64_t) e.dx * rows));
+}
+
+bool compareEdgeLessThan(const Edge& e1, const Edge& e2) {
     if (e1.yTop != e2.yTop) {
-        return(false);
+        return(e1.yTop < e2.yTop);
     }
 
-    int x1 = getX(e1,e1.yTop);
-    int x2 = getX(e2,e2.yTop);
+    int x1 = getCurrentX(e1);
+    int x2 = getCurrentX(e2);
 
     if (x1 == x2) {    
-        x1 = e1.slope;
-        x2 = e2.slope;
+        return(e1.dx < e2.dx);
     }
     return(x1 < x2);
 }
 
-bool compareEdgesByX(Edge& e1, Edge& e2, int y) {
-    int x1 = getX(e1,y);
-    int x2 = getX(e2,y);
-    return(x1 < x2);
-}
-
 
-#endif
\ No newline at end of file
+#endif
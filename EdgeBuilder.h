@@ -5,6 +5,7 @@
 #include "GPoint.h"
 #include "GMath.h"
 #include <vector>
+#include <algorithm>
 #include "GPath.h"
 
 class EdgeBuilder {
@@ -50,111 +51,265 @@ class EdgeBuilder {
             printf("[%d,%d]", clipLeft, clipRight);
         }
 
+        /**
+         * @brief Adds the edges of a quadratic, flattened to within t of the curve. Only the parts
+         * of the curve that can reach the clip are flattened; see addClippedCurve().
+         */
         void generateQuadraticEdgesAndAdd(GPoint& a, GPoint& b, GPoint& c, float t,std::vector<Edge>& edgeList) {
+            const GPoint pts[3] = { a, b, c };
+            addClippedCurve<3>(pts, t, edgeList);
+        }
+
+        /**
+         * @brief Adds the edges of a cubic, flattened to within t of the curve. Only the parts
+         * of the curve that can reach the clip are flattened; see addClippedCurve().
+         */
+        void generateCubicEdgesAndAdd(GPoint& a, GPoint& b, GPoint& c, GPoint& d, float t,std::vector<Edge>& edgeList) {
+            const GPoint pts[4] = { a, b, c, d };
+            addClippedCurve<4>(pts, t, edgeList);
+        }
 
+        /**
+         * @brief Returns how many equal steps in t keep a quadratic within tolerance of its chords.
+         * The distance from a chord to the curve is at most |a - 2b + c| / (4 * numSeg^2), so this
+         * keeps a margin of 4 on the tolerance.
+         */
+        static int quadSegmentCount(const GPoint& a, const GPoint& b, const GPoint& c, float tolerance) {
             float x = a.x() - (2 * b.x()) + c.x();
             float y = a.y() - (2 * b.y()) + c.y();
-            int numSeg = sqrt( sqrt(x*x + y*y) / t);
-            int nMax = log2(numSeg);
-            quadSegmentGenerator(a,b,c,numSeg,edgeList);
-            //generateQuadraticEdgesAndAdd(a,b,c,numSeg, 0, nMax, edgeList);
+            return std::max(GCeilToInt(sqrt(sqrt(x*x + y*y) / tolerance)), 1);
         }
 
-        void generateQuadraticEdgesAndAdd(GPoint& a, GPoint& b, GPoint& c, int numSeg, int n, int nMax, std::vector<Edge>& edgeList) {
-            bool aBounded = inTopBottomBounds(a);
-            bool bBounded = inTopBottomBounds(b);
-            bool cBounded = inTopBottomBounds(c);
+        /**
+         * @brief Returns how many equal steps in t keep a cubic within tolerance of its chords,
+         * bounding its second derivative by the larger of its two second differences.
+         */
+        static int cubicSegmentCount(const GPoint& a, const GPoint& b, const GPoint& c, const GPoint& d, float tolerance) {
+            float ux = a.x() - (2*b.x()) + c.x();
+            float uy = a.y() - (2*b.y()) + c.y();
+            float vx = b.x() - (2*c.x()) + d.x();
+            float vy = b.y() - (2*c.y()) + d.y();
+            float x = std::max(std::abs(ux), std::abs(vx));
+            float y = std::max(std::abs(uy), std::abs(vy));
+            float w = sqrt( (x*x) + (y*y) );
+            return std::max(GCeilToInt(sqrt((3.0 * w) / (4.0 * tolerance))), 1);
+        }
 
-            if (!aBounded && !bBounded && !cBounded) {
-                return;
+    private:
+
+        const int clipLeft;
+        const int clipTop;
+        const int clipRight;
+        const int clipBottom;
+
+        void validate() const {
+            assert(clipLeft <= clipRight);
+            assert(clipTop <= clipBottom);
+        }
+
+        /**
+         * @brief Chops a quadratic (N == 3) or cubic (N == 4) at its x and y extrema, so that every
+         * piece only moves one way along each axis and so lies within the box of its endpoints.
+         * Pieces above or below the clip are dropped, pieces partly above or below are trimmed,
+         * and whatever lies left or right of the clip becomes a vertical edge on that side, which
+         * is exactly what flattening it would have produced. Only what is visible gets flattened.
+         */
+        template <int N> void addClippedCurve(const GPoint pts[N], float tolerance, std::vector<Edge>& edgeList) {
+            float ts[4];
+            int count = curveExtrema<N>(pts, 0, ts);
+            count += curveExtrema<N>(pts, 1, ts + count);
+            std::sort(ts, ts + count);
+
+            GPoint piece[N];
+            std::copy(pts, pts + N, piece);
+            float prevT = 0;
+            for (int i = 0; i < count; i++) {
+                if (ts[i] <= prevT) {
+                    continue;
+                }
+                GPoint left[N];
+                chopCurve<N>(piece, (ts[i] - prevT) / (1 - prevT), left, piece);
+                addMonotonicCurve<N>(left, tolerance, edgeList);
+                prevT = ts[i];
             }
-            if ( (aBounded && bBounded && cBounded) || n >= nMax) {
-                quadSegmentGenerator(a, b, c, numSeg>>n , edgeList);
+            addMonotonicCurve<N>(piece, tolerance, edgeList);
+        }
+
+        template <int N> void addMonotonicCurve(GPoint pts[N], float tolerance, std::vector<Edge>& edgeList) {
+            // Trimming away rows outside the clip never changes which edges are made, because
+            // generateAndAddEdge clamps every line to the same rows.
+            if (!trimCurve<N>(pts, 1, clipTop, clipBottom)) {
                 return;
             }
 
-            GPoint dst[5];
-            GPoint src[3];
-            src[0] = a;
-            src[1] = b;
-            src[2] = c;
-            GPath::ChopQuadAt(src,dst,0.5);
+            // Columns outside the clip become vertical edges at the clip, so they are split off
+            // and added as a single line rather than being flattened.
+            GPoint inside[N];
+            std::copy(pts, pts + N, inside);
+            float x0 = pts[0].x();
+            float x1 = pts[N-1].x();
+            float lo = std::min(x0, x1);
+            float hi = std::max(x0, x1);
+
+            if (hi <= clipLeft || lo >= clipRight) {
+                float x = hi <= clipLeft ? clipLeft : clipRight;
+                generateAndAddEdge(GPoint::Make(x, pts[0].y()), GPoint::Make(x, pts[N-1].y()), edgeList);
+                return;
+            }
+            if (lo < clipLeft || hi > clipRight) {
+                float yBefore = pts[0].y();
+                float yAfter = pts[N-1].y();
+                trimCurve<N>(inside, 0, clipLeft, clipRight);
+                float xStart = x0 < clipLeft ? clipLeft : clipRight;
+                float xEnd = x1 < clipLeft ? clipLeft : clipRight;
+                if (x0 < clipLeft || x0 > clipRight) {
+                    generateAndAddEdge(GPoint::Make(xStart, yBefore), GPoint::Make(xStart, inside[0].y()), edgeList);
+                }
+                if (x1 < clipLeft || x1 > clipRight) {
+                    generateAndAddEdge(GPoint::Make(xEnd, inside[N-1].y()), GPoint::Make(xEnd, yAfter), edgeList);
+                }
+            }
 
-            generateQuadraticEdgesAndAdd(src[0],src[1],src[2], numSeg, n+1, nMax, edgeList);
-            generateQuadraticEdgesAndAdd(src[2],src[3],src[4], numSeg, n+1, nMax, edgeList);
-            
+            if (N == 3) {
+                quadSegmentGenerator(inside[0], inside[1], inside[2], quadSegmentCount(inside[0], inside[1], inside[2], tolerance), edgeList);
+            } else {
+                cubicSegmentGenerator(inside[0], inside[1], inside[2], inside[3],
+                                      cubicSegmentCount(inside[0], inside[1], inside[2], inside[3], tolerance), edgeList);
+            }
         }
 
-        void generateCubicEdgesAndAdd(GPoint& a, GPoint& b, GPoint& c, GPoint& d, float t,std::vector<Edge>& edgeList) {
+        static float curveCoord(const GPoint& p, int axis) {
+            return axis == 0 ? p.x() : p.y();
+        }
 
-            float ux = a.x() - (2*b.x()) + c.x();
-            float uy = a.y() - (2*b.y()) + c.y();
-            float vx = b.x() - (2*c.x()) + d.x();
-            float vy = b.y() - (2*c.y()) + d.y();
-            
-            float x = std::max(ux, vx);
-            float y = std::max(uy, vy);
+        static void setCurveCoord(GPoint& p, int axis, float v) {
+            if (axis == 0) {
+                p.fX = v;
+            } else {
+                p.fY = v;
+            }
+        }
 
-            float w = sqrt( (x*x) + (y*y) );
-            int numSeg = sqrt( (3.0 * w) / (4.0*t) );
-            int nMax = log2(numSeg);
-            //generateCubicEdgesAndAdd(a,b,c,d,numSeg, 0, nMax, edgeList);
-            cubicSegmentGenerator(a,b,c,d,numSeg, edgeList);
+        template <int N> static float evalCurve(const GPoint pts[N], int axis, float t) {
+            if (N == 3) {
+                return hornerEvalQuad(curveCoord(pts[0], axis), curveCoord(pts[1], axis), curveCoord(pts[2], axis), t);
+            }
+            return hornerEvalCubic(curveCoord(pts[0], axis), curveCoord(pts[1], axis), curveCoord(pts[2], axis), curveCoord(pts[N-1], axis), t);
         }
 
-        void generateCubicEdgesAndAdd(GPoint& a, GPoint& b, GPoint& c, GPoint& d, int numSeg, int n, int nMax, std::vector<Edge>& edgeList) {
-            bool aBounded = inTopBottomBounds(a);
-            bool bBounded = inTopBottomBounds(b);
-            bool cBounded = inTopBottomBounds(c);
-            bool dBounded = inTopBottomBounds(d);
+        //Splits the curve at t into left (0...t) and right (t...1). right may alias src.
+        template <int N> static void chopCurve(const GPoint src[N], float t, GPoint left[N], GPoint right[N]) {
+            GPoint dst[2*N - 1];
+            if (N == 3) {
+                GPath::ChopQuadAt(src, dst, t);
+            } else {
+                GPath::ChopCubicAt(src, dst, t);
+            }
+            std::copy(dst, dst + N, left);
+            std::copy(dst + N - 1, dst + 2*N - 1, right);
+        }
 
-            if (!aBounded && !bBounded && !cBounded && !dBounded) {
-                return;
+        /**
+         * @brief Writes the values of t strictly inside (0, 1) where the curve turns around along
+         * the given axis (0 for x, 1 for y), and returns how many there are.
+         */
+        template <int N> static int curveExtrema(const GPoint pts[N], int axis, float ts[]) {
+            float v0 = curveCoord(pts[0], axis);
+            float v1 = curveCoord(pts[1], axis);
+            float v2 = curveCoord(pts[2], axis);
+            int count = 0;
+
+            if (N == 3) {
+                float denom = v0 - (2 * v1) + v2;
+                if (denom != 0) {
+                    addUnitRoot((v0 - v1) / denom, ts, count);
+                }
+                return count;
             }
 
-            if ( (aBounded && bBounded && cBounded && dBounded) || n >= nMax) {
-                cubicSegmentGenerator(a, b, c, d, numSeg>>n , edgeList);
-                return;
+            // The derivative of a cubic is 3 (A t^2 + B t + C).
+            float v3 = curveCoord(pts[N-1], axis);
+            double A = -v0 + (3.0 * v1) - (3.0 * v2) + v3;
+            double B = 2.0 * (v0 - (2.0 * v1) + v2);
+            double C = v1 - v0;
+            if (A == 0) {
+                if (B != 0) {
+                    addUnitRoot(-C / B, ts, count);
+                }
+                return count;
+            }
+            double disc = (B * B) - (4.0 * A * C);
+            if (disc < 0) {
+                return count;
             }
+            double root = std::sqrt(disc);
+            addUnitRoot((-B - root) / (2.0 * A), ts, count);
+            addUnitRoot((-B + root) / (2.0 * A), ts, count);
+            return count;
+        }
 
-            GPoint midPoint = GPoint::Make(
-                (a.x() + (2*b.x()) + (3*c.x()) + d.x()) / 8.0,
-                (a.y() + (2*b.y()) + (3*c.y()) + d.y()) / 8.0
-            );
-
-            GPoint newB1 = GPoint::Make(
-                (a.x() + b.x()) / 2.0,
-                (a.y() + b.y()) / 2.0
-            );
-            GPoint newC1 = GPoint::Make(
-                (a.x() + (2 * b.x()) + c.x() ) / 4.0,
-                (a.y() + (2 * b.y()) + c.y() ) / 4.0
-            );
-
-            GPoint newB2 = GPoint::Make(
-                (b.x() + (2*c.x()) + d.x()) / 4.0,
-                (b.y() + (2*c.y()) + d.y()) / 4.0
-            );
-            GPoint newC2 = GPoint::Make(
-                (c.x() + d.x()) / 2.0,
-                (c.y() + d.y()) / 2.0
-            );
-
-            generateCubicEdgesAndAdd(a, newB1, newC1, midPoint, numSeg, n+1, nMax, edgeList);
-            generateCubicEdgesAndAdd(midPoint, newB2, newC2, c, numSeg, n+1, nMax, edgeList);
-            
+        static void addUnitRoot(double t, float ts[], int& count) {
+            if (t > 0 && t < 1) {
+                ts[count++] = t;
+            }
         }
 
-    private:
+        /**
+         * @brief Cuts away the parts of a curve that is monotonic along axis lying outside
+         * [lo, hi] on that axis, snapping the new ends onto the boundary.
+         * 
+         * @return false if nothing is left.
+         */
+        template <int N> static bool trimCurve(GPoint pts[N], int axis, float lo, float hi) {
+            float start = curveCoord(pts[0], axis);
+            float end = curveCoord(pts[N-1], axis);
+            bool increasing = start <= end;
+            float vMin = increasing ? start : end;
+            float vMax = increasing ? end : start;
+
+            if (vMax <= lo || vMin >= hi) {
+                return false;
+            }
 
-        const int clipLeft;
-        const int clipTop;
-        const int clipRight;
-        const int clipBottom;
+            if (vMin < lo) {
+                float t = solveMonotonic<N>(pts, axis, lo, increasing);
+                GPoint left[N];
+                if (increasing) {
+                    chopCurve<N>(pts, t, left, pts);
+                    setCurveCoord(pts[0], axis, lo);
+                } else {
+                    chopCurve<N>(pts, t, pts, left);
+                    setCurveCoord(pts[N-1], axis, lo);
+                }
+            }
 
-        void validate() const {
-            assert(clipLeft <= clipRight);
-            assert(clipTop <= clipBottom);
+            if (vMax > hi) {
+                float t = solveMonotonic<N>(pts, axis, hi, increasing);
+                GPoint right[N];
+                if (increasing) {
+                    chopCurve<N>(pts, t, pts, right);
+                    setCurveCoord(pts[N-1], axis, hi);
+                } else {
+                    chopCurve<N>(pts, t, right, pts);
+                    setCurveCoord(pts[0], axis, hi);
+                }
+            }
+            return true;
+        }
+
+        //Bisects for the t at which a monotonic curve reaches value along axis.
+        template <int N> static float solveMonotonic(const GPoint pts[N], int axis, float value, bool increasing) {
+            float tLo = 0;
+            float tHi = 1;
+            for (int i = 0; i < 24; i++) {
+                float mid = (tLo + tHi) * 0.5f;
+                if ((evalCurve<N>(pts, axis, mid) < value) == increasing) {
+                    tLo = mid;
+                } else {
+                    tHi = mid;
+                }
+            }
+            return (tLo + tHi) * 0.5f;
         }
 
         //Assumes y1 > y2
@@ -217,48 +372,129 @@ class EdgeBuilder {
         }
 
 
-    bool inTopBottomBounds(GPoint& p) {
-        return p.y() < clipBottom && p.y() > clipTop;
-    }
-
-    void quadSegmentGenerator (GPoint& a, GPoint& b, GPoint& c, int numSeg, std::vector<Edge>& edgeList) {
-        
-        GPoint prev = a;
 
-        float t = 1.0/numSeg;
-        float dt = t;
-
-        for (int i = 1; i < numSeg-1; i++) {
-            GPoint current = GPoint::Make(hornerEvalQuad(a.x(), b.x(), c.x(), t), hornerEvalQuad(a.y(), b.y(), c.y(), t));
-            generateAndAddEdge(prev, current, edgeList);
-            prev = current;
-            t += dt;
+        /**
+         * @brief True if the rounded endpoints of every segment inside this hull land strictly
+         * within the clip, where generateAndAddEdge would neither trim nor project anything.
+         */
+        bool hullInsideClip(const GPoint pts[], int count) const {
+            for (int i = 0; i < count; i++) {
+                bool inside = pts[i].x() >= clipLeft + 1 && pts[i].x() <= clipRight - 1 &&
+                              pts[i].y() >= clipTop && pts[i].y() <= clipBottom;
+                if (!inside) {
+                    return false;
+                }
+            }
+            return true;
         }
-        generateAndAddEdge(prev, c, edgeList);
-        
-    }
-
-    void cubicSegmentGenerator (GPoint& a, GPoint& b, GPoint& c, GPoint& d, int numSeg, std::vector<Edge>& edgeList) {
-        
-        if (numSeg == 0) {
-            numSeg = 1;
+
+        /**
+         * @brief Adds the edge for a segment already known to lie inside the clip.
+         */
+        void addUnclippedEdge(const GPoint& p1, const GPoint& p2, std::vector<Edge>& edgeList) {
+            int y1 = GRoundToInt(p1.y());
+            int y2 = GRoundToInt(p2.y());
+            if (y1 == y2) {
+                return;
+            }
+            float m = (p2.x() - p1.x())/(p2.y() - p1.y());
+            float b = p2.x() - (m*p2.y());
+            if (y2 > y1) {
+                edgeList.push_back(makeEdge(y1, y2, m, b, 1));
+            } else {
+                edgeList.push_back(makeEdge(y2, y1, m, b, -1));
+            }
         }
 
-        GPoint prev = a;
+        /**
+         * @brief Flattens the quadratic into numSeg chords using forward differences, so each point
+         * costs two additions per axis instead of a polynomial evaluation. Chords of a curve whose
+         * control points sit inside the clip skip the clipping code entirely.
+         */
+        void quadSegmentGenerator (GPoint& a, GPoint& b, GPoint& c, int numSeg, std::vector<Edge>& edgeList) {
+            
+            const GPoint hull[3] = { a, b, c };
+            bool inside = hullInsideClip(hull, 3);
+
+            // P(t) = A t^2 + B t + a
+            double h = 1.0 / numSeg;
+            double Ax = a.x() - (2.0 * b.x()) + c.x();
+            double Ay = a.y() - (2.0 * b.y()) + c.y();
+            double Bx = 2.0 * (b.x() - a.x());
+            double By = 2.0 * (b.y() - a.y());
+
+            double x = a.x();
+            double y = a.y();
+            double dx = (Ax * h * h) + (Bx * h);
+            double dy = (Ay * h * h) + (By * h);
+            double ddx = 2.0 * Ax * h * h;
+            double ddy = 2.0 * Ay * h * h;
+
+            GPoint prev = a;
+            for (int i = 1; i < numSeg; i++) {
+                x += dx;
+                y += dy;
+                dx += ddx;
+                dy += ddy;
+                GPoint current = GPoint::Make(x, y);
+                addSegment(prev, current, inside, edgeList);
+                prev = current;
+            }
+            addSegment(prev, c, inside, edgeList);
+            
+        }
 
-        float t = 1.0/numSeg;
-        float dt = t;
+        /**
+         * @brief Flattens the cubic into numSeg chords using forward differences.
+         */
+        void cubicSegmentGenerator (GPoint& a, GPoint& b, GPoint& c, GPoint& d, int numSeg, std::vector<Edge>& edgeList) {
+            
+            const GPoint hull[4] = { a, b, c, d };
+            bool inside = hullInsideClip(hull, 4);
+
+            // P(t) = A t^3 + B t^2 + C t + a
+            double h = 1.0 / numSeg;
+            double h2 = h * h;
+            double h3 = h2 * h;
+            double Ax = (3.0 * b.x()) + d.x() - (3.0 * c.x()) - a.x();
+            double Ay = (3.0 * b.y()) + d.y() - (3.0 * c.y()) - a.y();
+            double Bx = (3.0 * c.x()) - (6.0 * b.x()) + (3.0 * a.x());
+            double By = (3.0 * c.y()) - (6.0 * b.y()) + (3.0 * a.y());
+            double Cx = 3.0 * (b.x() - a.x());
+            double Cy = 3.0 * (b.y() - a.y());
+
+            double x = a.x();
+            double y = a.y();
+            double dx = (Ax * h3) + (Bx * h2) + (Cx * h);
+            double dy = (Ay * h3) + (By * h2) + (Cy * h);
+            double ddx = (6.0 * Ax * h3) + (2.0 * Bx * h2);
+            double ddy = (6.0 * Ay * h3) + (2.0 * By * h2);
+            double dddx = 6.0 * Ax * h3;
+            double dddy = 6.0 * Ay * h3;
+
+            GPoint prev = a;
+            for (int i = 1; i < numSeg; i++) {
+                x += dx;
+                y += dy;
+                dx += ddx;
+                dy += ddy;
+                ddx += dddx;
+                ddy += dddy;
+                GPoint current = GPoint::Make(x, y);
+                addSegment(prev, current, inside, edgeList);
+                prev = current;
+            }
+            addSegment(prev, d, inside, edgeList);
 
-        for (int i = 1; i < numSeg-1; i++) {
-            GPoint current = GPoint::Make(hornerEvalCubic(a.x(), b.x(), c.x(), d.x(), t), hornerEvalCubic(a.y(), b.y(), c.y(), d.y(), t));
-            generateAndAddEdge(prev, current, edgeList);
-            prev = current;
-            t += dt;
         }
-        generateAndAddEdge(prev, d, edgeList);
-
-    }
 
+        void addSegment(const GPoint& p1, const GPoint& p2, bool inside, std::vector<Edge>& edgeList) {
+            if (inside) {
+                addUnclippedEdge(p1, p2, edgeList);
+            } else {
+                generateAndAddEdge(p1, p2, edgeList);
+            }
+        }
     
 
 };
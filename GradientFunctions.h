@@ -1,16 +1,177 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef GradientFunctions_DEFINED
+#define GradientFunctions_DEFINED
+
+#include "GMatrix.h"
+#include "GShader.h"
+#include "GradientLUT.h"
+#include "RowMapper.h"
+#include <algorithm>
 #include <cmath>
 #include <math.h>
 
-typedef float (*GradientFunction) (float, float);
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief The gradient shapes, each turning a point in the gradient's unit space into t. Every
+ * shape maps one point at a time and, where SSE2 is available, four at a time, and the two do
+ * the same float operations in the same order, so a pixel's t never depends on where its span
+ * starts.
+ */
+
+struct LinearGradientMap {
+    static float map(float x, float) {
+        return x;
+    }
+#if defined(__SSE2__)
+    static __m128 map(__m128 x, __m128) {
+        return x;
+    }
+#endif
+};
+
+struct RadialGradientMap {
+    static float map(float x, float y) {
+        return std::sqrt(x*x + y*y);
+    }
+#if defined(__SSE2__)
+    static __m128 map(__m128 x, __m128 y) {
+        return _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+    }
+#endif
+};
+
+/**
+ * @brief The angle of (y, x) around the origin, as (atan2(x, y) + pi) / 2pi. atan is a
+ * polynomial on [0, 1], off by at most about 1e-5 radians, which is far finer than the color
+ * table it indexes.
+ */
+struct RayGradientMap {
+    static float map(float x, float y) {
+        float ax = std::abs(x);
+        float ay = std::abs(y);
+        float hi = std::max(ax, ay);
+        float lo = std::min(ax, ay);
+        float a = hi > 0 ? lo / hi : 0;
+        float r = atanUnit(a);
+        if (ax > ay) {
+            r = kHalfPi - r;
+        }
+        if (std::signbit(y)) {
+            r = kPi - r;
+        }
+        r = std::copysign(r, x);
+        return (r + kPi) * kInvTwoPi;
+    }
+#if defined(__SSE2__)
+    static __m128 map(__m128 x, __m128 y) {
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        __m128 ax = _mm_andnot_ps(signBit, x);
+        __m128 ay = _mm_andnot_ps(signBit, y);
+        __m128 hi = _mm_max_ps(ax, ay);
+        __m128 lo = _mm_min_ps(ax, ay);
+        __m128 a = _mm_and_ps(_mm_div_ps(lo, hi), _mm_cmpgt_ps(hi, _mm_setzero_ps()));
+        __m128 r = atanUnit(a);
+        r = select(_mm_cmpgt_ps(ax, ay), _mm_sub_ps(_mm_set1_ps(kHalfPi), r), r);
+        __m128 yNegative = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(y), 31));
+        r = select(yNegative, _mm_sub_ps(_mm_set1_ps(kPi), r), r);
+        r = _mm_or_ps(r, _mm_and_ps(x, signBit));
+        return _mm_mul_ps(_mm_add_ps(r, _mm_set1_ps(kPi)), _mm_set1_ps(kInvTwoPi));
+    }
+#endif
+
+    private:
+
+        static constexpr float kPi = (float) M_PI;
+        static constexpr float kHalfPi = (float) (M_PI / 2);
+        static constexpr float kInvTwoPi = (float) (1 / (2 * M_PI));
+
+        static constexpr float kAtan1 = 0.9998660f;
+        static constexpr float kAtan3 = -0.3302995f;
+        static constexpr float kAtan5 = 0.1801410f;
+        static constexpr float kAtan7 = -0.0851330f;
+        static constexpr float kAtan9 = 0.0208351f;
+
+        // atan(a) for 0 <= a <= 1 (Abramowitz and Stegun 4.4.49).
+        static float atanUnit(float a) {
+            float s = a * a;
+            float r = (kAtan9 * s) + kAtan7;
+            r = (r * s) + kAtan5;
+            r = (r * s) + kAtan3;
+            r = (r * s) + kAtan1;
+            return r * a;
+        }
+#if defined(__SSE2__)
+        static __m128 atanUnit(__m128 a) {
+            __m128 s = _mm_mul_ps(a, a);
+            __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kAtan9), s), _mm_set1_ps(kAtan7));
+            r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(kAtan5));
+            r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(kAtan3));
+            r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(kAtan1));
+            return _mm_mul_ps(r, a);
+        }
+
+        static __m128 select(__m128 mask, __m128 a, __m128 b) {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+#endif
+};
+
+/**
+ * @brief Shades a row of a gradient of shape Map, mapped through matrix into the gradient's unit
+ * space and tiled by TileMode: four pixels at a time are mapped, turned into t and then into
+ * table indices, leaving only the table loads one at a time.
+ */
+template <typename Map, GShader::TileMode TileMode>
+static void shadeGradientRow(const GMatrix& matrix, const GradientLUT& lut, int x, int y, int count, GPixel row[]) {
+    const int kBlock = 64;
+    float u[kBlock];
+    float v[kBlock];
+    for (int start = 0; start < count; start += kBlock) {
+        int n = std::min(kBlock, count - start);
+        mapRowCenters(matrix, x + start, y, n, u, v);
+        GPixel* dst = row + start;
 
-static float mapToLinear(float x, float y) {
-    return x;
+        int i = 0;
+#if defined(__SSE2__)
+        for (; i + 4 <= n; i += 4) {
+            __m128i index = GradientLUT::index<TileMode>(Map::map(_mm_loadu_ps(&u[i]), _mm_loadu_ps(&v[i])));
+            dst[i + 0] = lut[_mm_cvtsi128_si32(index)];
+            dst[i + 1] = lut[_mm_cvtsi128_si32(_mm_shuffle_epi32(index, _MM_SHUFFLE(1, 1, 1, 1)))];
+            dst[i + 2] = lut[_mm_cvtsi128_si32(_mm_shuffle_epi32(index, _MM_SHUFFLE(2, 2, 2, 2)))];
+            dst[i + 3] = lut[_mm_cvtsi128_si32(_mm_shuffle_epi32(index, _MM_SHUFFLE(3, 3, 3, 3)))];
+        }
+#endif
+        for (; i < n; i++) {
+            dst[i] = lut[GradientLUT::index<TileMode>(Map::map(u[i], v[i]))];
+        }
+    }
 }
 
-static float mapToRadial(float x, float y) {
-    return std::sqrt(x*x + y*y);
+/**
+ * @brief shadeGradientRow() with the tile mode chosen at run time.
+ */
+template <typename Map>
+static void shadeGradientRow(const GMatrix& matrix, const GradientLUT& lut, GShader::TileMode tileMode,
+                             int x, int y, int count, GPixel row[]) {
+    switch (tileMode) {
+        default:
+        case GShader::kClamp:
+            shadeGradientRow<Map, GShader::kClamp>(matrix, lut, x, y, count, row);
+            break;
+        case GShader::kRepeat:
+            shadeGradientRow<Map, GShader::kRepeat>(matrix, lut, x, y, count, row);
+            break;
+        case GShader::kMirror:
+            shadeGradientRow<Map, GShader::kMirror>(matrix, lut, x, y, count, row);
+            break;
+    }
 }
 
-static float mapToRadialRays(float x, float y) {
-    return (std::atan2(x,y) + M_PI) / (2.0 * M_PI);
-}
\ No newline at end of file
+#endif
@@ -0,0 +1,149 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef GradientLUT_DEFINED
+#define GradientLUT_DEFINED
+
+#include "GColor.h"
+#include "GPixel.h"
+#include "GShader.h"
+#include "BlendFunctions.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief A gradient's colors baked once into premultiplied pixels, so shading a pixel is one
+ * table load rather than two color fetches, a lerp and a premultiply.
+ *
+ * Entry 1 + i holds the gradient at the middle of [i / kSize, (i + 1) / kSize), so any t is at
+ * most half an entry from the color it gets. Entries 0 and kSize + 1 hold the exact end colors,
+ * for t clamped past either end. The tile modes only change how t becomes an index.
+ */
+class GradientLUT {
+
+    public:
+
+        static const int kSize = 1024;
+
+        GradientLUT() {
+            std::fill_n(entries, kSize + 2, 0);
+        }
+
+        /**
+         * @brief Bakes the gradient through count colors spaced evenly from t = 0 to t = 1. With
+         * no colors every pixel is transparent.
+         */
+        void build(const GColor colors[], int count) {
+            if (count < 1) {
+                std::fill_n(entries, kSize + 2, 0);
+                return;
+            }
+            entries[0] = makePremultPixel(colors[0]);
+            entries[kSize + 1] = makePremultPixel(colors[count - 1]);
+            if (count == 1) {
+                std::fill_n(entries, kSize + 2, entries[0]);
+                return;
+            }
+            for (int i = 0; i < kSize; i++) {
+                float loc = ((i + 0.5f) / kSize) * (count - 1);
+                int index = std::min(GFloorToInt(loc), count - 2);
+                entries[1 + i] = interpolate(colors[index], colors[index + 1], loc - index);
+            }
+        }
+
+        GPixel operator[](int index) const {
+            return entries[index];
+        }
+
+        /**
+         * @brief Returns the entry for t, tiled by TileMode.
+         */
+        template <GShader::TileMode TileMode> static int index(float t) {
+            switch (TileMode) {
+                default:
+                case GShader::kClamp:
+                    if (!(t > 0)) {
+                        return 0;
+                    }
+                    if (t >= 1) {
+                        return kSize + 1;
+                    }
+                    return 1 + (int) (t * kSize);
+                case GShader::kRepeat:
+                    return 1 + (periodIndex(t) & (kSize - 1));
+                case GShader::kMirror: {
+                    int i = periodIndex(t) & ((2 * kSize) - 1);
+                    return 1 + (i < kSize ? i : ((2 * kSize) - 1) - i);
+                }
+            }
+        }
+
+#if defined(__SSE2__)
+        /**
+         * @brief index() for four values of t at once. Every lane comes out exactly as index()
+         * would give it.
+         */
+        template <GShader::TileMode TileMode> static __m128i index(__m128 t) {
+            const __m128i one = _mm_set1_epi32(1);
+            switch (TileMode) {
+                default:
+                case GShader::kClamp: {
+                    __m128i i = _mm_add_epi32(_mm_cvttps_epi32(_mm_mul_ps(t, _mm_set1_ps(kSize))), one);
+                    __m128i low = _mm_castps_si128(_mm_cmpngt_ps(t, _mm_setzero_ps()));
+                    __m128i high = _mm_castps_si128(_mm_cmpge_ps(t, _mm_set1_ps(1)));
+                    i = _mm_andnot_si128(low, i);
+                    return select(high, _mm_set1_epi32(kSize + 1), i);
+                }
+                case GShader::kRepeat:
+                    return _mm_add_epi32(_mm_and_si128(periodIndex(t), _mm_set1_epi32(kSize - 1)), one);
+                case GShader::kMirror: {
+                    __m128i i = _mm_and_si128(periodIndex(t), _mm_set1_epi32((2 * kSize) - 1));
+                    __m128i reflected = _mm_sub_epi32(_mm_set1_epi32((2 * kSize) - 1), i);
+                    __m128i upper = _mm_cmpgt_epi32(i, _mm_set1_epi32(kSize - 1));
+                    return _mm_add_epi32(select(upper, reflected, i), one);
+                }
+            }
+        }
+#endif
+
+    private:
+
+        GPixel entries[kSize + 2];
+
+        /**
+         * @brief Returns floor(t * kSize) taken into [0, 2 * kSize], a whole number of mirror
+         * periods away, so that it always fits in an int. Both wrapping modes mask it from there.
+         */
+        static int periodIndex(float t) {
+            float p = t * kSize;
+            p -= std::floor(p * (0.5f / kSize)) * (2 * kSize);
+            return (int) p;
+        }
+
+#if defined(__SSE2__)
+        static __m128i periodIndex(__m128 t) {
+            __m128 p = _mm_mul_ps(t, _mm_set1_ps(kSize));
+            __m128 periods = _mm_mul_ps(p, _mm_set1_ps(0.5f / kSize));
+
+            // floor(), built from truncation, which only differs below zero.
+            __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(periods));
+            __m128 floored = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, periods), _mm_set1_ps(1)));
+
+            p = _mm_sub_ps(p, _mm_mul_ps(floored, _mm_set1_ps(2 * kSize)));
+            return _mm_cvttps_epi32(p);
+        }
+
+        static __m128i select(__m128i mask, __m128i a, __m128i b) {
+            return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+        }
+#endif
+
+};
+
+#endif
@@ -7,6 +7,38 @@
 #ifndef CanvasUtil_DEFINED
 #define CanvasUtil_DEFINED
 
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief A 16.16 fixed point number.
+ */
+typedef int32_t GFixed;
+
+/**
+ * @brief Converts a value to 16.16 fixed point, rounding to the nearest 1/65536.
+ */
+static inline GFixed doubleToFixed(double value) {
+    return((GFixed) floor((value * 65536.0) + 0.5));
+}
+
+/**
+ * @brief Returns floor(value) for values that fit in 64 bits, with a truncating conversion
+ * rather than a call to floor.
+ */
+static inline int64_t floorToInt64(double value) {
+    int64_t truncated = (int64_t) value;
+    return(truncated - (value < truncated));
+}
+
+/**
+ * @brief Returns origin in 16.16 fixed point, advanced n steps of step. The steps are taken from
+ * origin in 64-bit integer math, so the nth value is the same whichever step a loop starts at.
+ */
+static inline GFixed stepFixed(double origin, GFixed step, int n) {
+    return((GFixed) (floorToInt64((origin * 65536.0) + 0.5) + ((int64_t) step * n)));
+}
+
 /**
  * @brief Makes a fast approximation of dividing an int by 255.
  * Note: This can only be used for int values do not exceed 16 bits.
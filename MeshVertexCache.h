@@ -0,0 +1,108 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef MeshVertexCache_DEFINED
+#define MeshVertexCache_DEFINED
+
+#include "GPoint.h"
+#include "GColor.h"
+#include "GMatrix.h"
+#include "ScratchArena.h"
+#include <algorithm>
+
+/**
+ * @brief Everything a mesh's triangles need from its vertices, worked out once per vertex rather
+ * than once per triangle corner. Positions are mapped to device space, colors are pinned and
+ * premultiplied, and texture coordinates are copied alongside, each channel in its own array.
+ *
+ * In an indexed grid every inner vertex is a corner of six triangles, so this does about a sixth
+ * of the vertex work that fetching and mapping corners triangle by triangle did.
+ */
+class MeshVertexCache {
+
+    public:
+
+        MeshVertexCache() : count(0), hasColors(false), hasTexs(false) {}
+
+        /**
+         * @brief Fills the cache for every vertex that indices refers to. The arrays come from arena
+         * and stay valid until it is next reset.
+         */
+        void prepare(const GPoint verts[], const GColor colors[], const GPoint texs[], const int indices[],
+                     int triangleCount, const GMatrix& ctm, ScratchArena& arena) {
+            count = *std::max_element(indices, indices + (triangleCount * 3)) + 1;
+            hasColors = colors != nullptr;
+            hasTexs = texs != nullptr;
+
+            x = arena.allocate<float>(count);
+            y = arena.allocate<float>(count);
+            for (int i = 0; i < count; i++) {
+                x[i] = (ctm[GMatrix::SX] * verts[i].x()) + (ctm[GMatrix::KX] * verts[i].y()) + ctm[GMatrix::TX];
+                y[i] = (ctm[GMatrix::KY] * verts[i].x()) + (ctm[GMatrix::SY] * verts[i].y()) + ctm[GMatrix::TY];
+            }
+
+            if (hasColors) {
+                r = arena.allocate<float>(count);
+                g = arena.allocate<float>(count);
+                b = arena.allocate<float>(count);
+                a = arena.allocate<float>(count);
+                for (int i = 0; i < count; i++) {
+                    GColor c = colors[i].pinToUnit();
+                    r[i] = c.r * c.a;
+                    g[i] = c.g * c.a;
+                    b[i] = c.b * c.a;
+                    a[i] = c.a;
+                }
+            }
+
+            if (hasTexs) {
+                u = arena.allocate<float>(count);
+                v = arena.allocate<float>(count);
+                for (int i = 0; i < count; i++) {
+                    u[i] = texs[i].x();
+                    v[i] = texs[i].y();
+                }
+            }
+        }
+
+        GPoint point(int i) const {
+            return GPoint::Make(x[i], y[i]);
+        }
+
+        //Returns the vertex's color, already premultiplied by its alpha.
+        GColor color(int i) const {
+            return GColor::RGBA(r[i], g[i], b[i], a[i]);
+        }
+
+        GPoint tex(int i) const {
+            return GPoint::Make(u[i], v[i]);
+        }
+
+        bool colored() const {
+            return hasColors;
+        }
+
+        bool textured() const {
+            return hasTexs;
+        }
+
+    private:
+
+        int count;
+        bool hasColors;
+        bool hasTexs;
+
+        float* x;
+        float* y;
+        float* r;
+        float* g;
+        float* b;
+        float* a;
+        float* u;
+        float* v;
+
+};
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef MipMap_DEFINED
+#define MipMap_DEFINED
+
+#include "GBitmap.h"
+#include "GMatrix.h"
+#include "GPixel.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief A bitmap and its successive halvings, down to a single pixel, for shaders that draw the
+ * bitmap smaller than it is. Sampling a level near the size it is drawn at keeps neighbouring
+ * device pixels on neighbouring texels, rather than skipping rows and columns of the bitmap.
+ *
+ * Level 0 is the bitmap itself, and each level after it is box filtered from the one before, a
+ * pixel being the average of the 2x2 pixels it covers, or of 3 across or down at an odd edge. Levels are only built once a draw needs
+ * them, and kept for every draw after it.
+ */
+class MipMap {
+
+    public:
+
+        /**
+         * @brief How a shader picks its level: never, the nearest level at or above the size it
+         * is drawn at, or a blend of the two levels either side of that size.
+         */
+        enum Mode {
+            kNone,
+            kNearest,
+            kLinear,
+        };
+
+        explicit MipMap(const GBitmap& bitmap) {
+            levels.push_back(bitmap);
+            int size = std::max(bitmap.width(), bitmap.height());
+            maxLevel = 0;
+            while (size > 1) {
+                size >>= 1;
+                maxLevel++;
+            }
+        }
+
+        MipMap(const MipMap&) = delete;
+        MipMap& operator=(const MipMap&) = delete;
+
+        int levelCount() const {
+            return maxLevel + 1;
+        }
+
+        /**
+         * @brief Returns level i, building it and every level before it that is still missing.
+         */
+        GBitmap level(int i) {
+            i = std::max(0, std::min(i, maxLevel));
+            while ((int) levels.size() <= i) {
+                GBitmap src = levels.back();
+                int width = std::max(1, src.width() / 2);
+                int height = std::max(1, src.height() / 2);
+                storage.emplace_back(new GPixel[(size_t) width * height]);
+                GBitmap dst(width, height, width * sizeof(GPixel), storage.back().get(), false);
+                downsample(src, dst);
+
+                // Averages of opaque pixels are opaque, so a level is opaque when the one before is.
+                levels.push_back(GBitmap(width, height, dst.rowBytes(), dst.pixels(), src.isOpaque()));
+            }
+            return levels[i];
+        }
+
+        /**
+         * @brief Returns how many levels down a map from device pixels to level 0 pixels should
+         * sample, as a fraction: log2 of the most bitmap pixels one device pixel step covers, or 0
+         * when the bitmap is not drawn smaller.
+         */
+        static float levelFor(const GMatrix& inverse) {
+            float across = std::hypot(inverse[GMatrix::SX], inverse[GMatrix::KY]);
+            float down = std::hypot(inverse[GMatrix::KX], inverse[GMatrix::SY]);
+            float footprint = std::max(across, down);
+            return footprint > 1 ? std::log2(footprint) : 0;
+        }
+
+        /**
+         * @brief Returns inverse, a map from device pixels to level 0 pixels, followed by the map
+         * from level 0 pixels to level i pixels.
+         */
+        GMatrix levelMatrix(int i, const GMatrix& inverse) {
+            GBitmap scaled = level(i);
+            return GMatrix::Concat(GMatrix::Scale((float) scaled.width() / levels[0].width(),
+                                                  (float) scaled.height() / levels[0].height()), inverse);
+        }
+
+    private:
+
+        std::vector<GBitmap> levels;
+        std::vector<std::unique_ptr<GPixel[]>> storage;
+        int maxLevel;
+
+        /**
+         * @brief Fills dst, half of src across and down, with the rounded average of each 2x2
+         * block of src. When a side of src is odd, the last pixel along it also averages in the
+         * column or row left over, so no part of src is dropped. Every channel is averaged alike,
+         * so premultiplied pixels stay premultiplied.
+         */
+        static void downsample(const GBitmap& src, const GBitmap& dst) {
+            // Columns before this end in whole 2x2 blocks.
+            int blockEnd = (src.width() & 1) ? dst.width() - 1 : dst.width();
+
+            for (int y = 0; y < dst.height(); y++) {
+                int top = 2 * y;
+                int bottom = (y == dst.height() - 1) ? src.height() : top + 2;
+                GPixel* row = dst.getAddr(0, y);
+
+                int x = 0;
+#if defined(__SSE2__)
+                if (bottom - top == 2) {
+                    const GPixel* above = src.getAddr(0, top);
+                    const GPixel* below = src.getAddr(0, top + 1);
+                    const __m128i zero = _mm_setzero_si128();
+                    const __m128i two = _mm_set1_epi16(2);
+                    for (; x + 2 <= blockEnd; x += 2) {
+                        __m128i a = _mm_loadu_si128((const __m128i*) (above + (2 * x)));
+                        __m128i b = _mm_loadu_si128((const __m128i*) (below + (2 * x)));
+
+                        // Column sums of the first two source pixels, then of the last two.
+                        __m128i left = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                        __m128i right = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                        left = _mm_add_epi16(left, _mm_srli_si128(left, 8));
+                        right = _mm_add_epi16(right, _mm_srli_si128(right, 8));
+
+                        __m128i sum = _mm_unpacklo_epi64(left, right);
+                        sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+                        _mm_storel_epi64((__m128i*) (row + x), _mm_packus_epi16(sum, zero));
+                    }
+                }
+#endif
+                for (; x < dst.width(); x++) {
+                    int left = 2 * x;
+                    int right = (x == dst.width() - 1) ? src.width() : left + 2;
+                    unsigned count = (right - left) * (bottom - top);
+                    GPixel result = 0;
+                    for (int shift = 0; shift < 32; shift += 8) {
+                        unsigned sum = 0;
+                        for (int sy = top; sy < bottom; sy++) {
+                            const GPixel* srcRow = src.getAddr(0, sy);
+                            for (int sx = left; sx < right; sx++) {
+                                sum += (srcRow[sx] >> shift) & 0xFF;
+                            }
+                        }
+                        result |= ((sum + (count / 2)) / count) << shift;
+                    }
+                    row[x] = result;
+                }
+            }
+        }
+
+};
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef RowMapper_DEFINED
+#define RowMapper_DEFINED
+
+#include "GMatrix.h"
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Maps the centers of the pixels [x, x + count) on row y through matrix, into u and v.
+ *
+ * Along a row only the center's x changes, and it steps by exactly 1, so the centers are stepped
+ * rather than built and the y terms are worked out once. Each coordinate is still the same sum
+ * of products as GMatrix::mapPoints, in the same order, so the two agree bit for bit.
+ */
+static inline void mapRowCenters(const GMatrix& matrix, int x, int y, int count, float u[], float v[]) {
+    const float sx = matrix[GMatrix::SX];
+    const float ky = matrix[GMatrix::KY];
+    const float kxy = matrix[GMatrix::KX] * (y + 0.5f);
+    const float syy = matrix[GMatrix::SY] * (y + 0.5f);
+    const float tx = matrix[GMatrix::TX];
+    const float ty = matrix[GMatrix::TY];
+    float cx = x + 0.5f;
+
+    int i = 0;
+#if defined(__SSE2__)
+    __m128 centers = _mm_add_ps(_mm_set1_ps(cx), _mm_setr_ps(0, 1, 2, 3));
+    const __m128 four = _mm_set1_ps(4);
+    for (; i + 4 <= count; i += 4) {
+        __m128 mu = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(sx), centers), _mm_set1_ps(kxy)), _mm_set1_ps(tx));
+        __m128 mv = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(ky), centers), _mm_set1_ps(syy)), _mm_set1_ps(ty));
+        _mm_storeu_ps(&u[i], mu);
+        _mm_storeu_ps(&v[i], mv);
+        centers = _mm_add_ps(centers, four);
+    }
+    cx += i;
+#endif
+    for (; i < count; i++) {
+        u[i] = ((sx * cx) + kxy) + tx;
+        v[i] = ((ky * cx) + syy) + ty;
+        cx += 1;
+    }
+}
+
+/**
+ * @brief Calls pixelProc(i, u, v) for each pixel i of the row [x, x + count) on row y, with
+ * (u, v) its center mapped through matrix. Centers are mapped a block at a time into fixed
+ * buffers, so a row of any length needs no memory of its own.
+ */
+template <typename PixelProc> static inline void mapRow(const GMatrix& matrix, int x, int y, int count, PixelProc pixelProc) {
+    const int kBlock = 64;
+    float u[kBlock];
+    float v[kBlock];
+    for (int start = 0; start < count; start += kBlock) {
+        int n = std::min(kBlock, count - start);
+        mapRowCenters(matrix, x + start, y, n, u, v);
+        for (int i = 0; i < n; i++) {
+            pixelProc(start + i, u[i], v[i]);
+        }
+    }
+}
+
+#endif
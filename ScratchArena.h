@@ -0,0 +1,81 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef ScratchArena_DEFINED
+#define ScratchArena_DEFINED
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief A bump allocator for the short-lived buffers a single draw needs. Allocations are never
+ * freed one at a time; reset() hands all of them back at once. When a draw outgrows the arena,
+ * the extra memory comes from overflow blocks, and the next reset() folds them into one block
+ * large enough for that draw, so repeating similar draws stops touching the heap.
+ */
+class ScratchArena {
+
+    public:
+
+        ScratchArena() : blockSize(0), used(0), overflowBytes(0) {}
+
+        ScratchArena(const ScratchArena&) = delete;
+        ScratchArena& operator=(const ScratchArena&) = delete;
+
+        ScratchArena(ScratchArena&& other) noexcept
+        : block(std::move(other.block)), blockSize(other.blockSize), used(other.used),
+          overflow(std::move(other.overflow)), overflowBytes(other.overflowBytes) {
+            other.blockSize = 0;
+            other.used = 0;
+            other.overflowBytes = 0;
+        }
+
+        /**
+         * @brief Returns uninitialized room for count objects of type T, valid until reset().
+         */
+        template <typename T> T* allocate(size_t count) {
+            static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+            static_assert(alignof(T) <= alignof(std::max_align_t), "arena blocks are only max_align_t aligned");
+
+            size_t bytes = count * sizeof(T);
+            size_t start = (used + alignof(T) - 1) & ~(alignof(T) - 1);
+            if (start + bytes <= blockSize) {
+                used = start + bytes;
+                return reinterpret_cast<T*>(block.get() + start);
+            }
+
+            overflow.push_back(std::unique_ptr<char[]>(new char[bytes]));
+            overflowBytes += bytes + alignof(std::max_align_t);
+            return reinterpret_cast<T*>(overflow.back().get());
+        }
+
+        /**
+         * @brief Releases everything allocated since the last reset.
+         */
+        void reset() {
+            if (!overflow.empty()) {
+                blockSize += overflowBytes;
+                block.reset(new char[blockSize]);
+                overflow.clear();
+                overflowBytes = 0;
+            }
+            used = 0;
+        }
+
+    private:
+
+        std::unique_ptr<char[]> block;
+        size_t blockSize;
+        size_t used;
+
+        std::vector<std::unique_ptr<char[]>> overflow;
+        size_t overflowBytes;
+
+};
+
+#endif
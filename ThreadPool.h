@@ -0,0 +1,131 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef ThreadPool_DEFINED
+#define ThreadPool_DEFINED
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A fixed set of worker threads that run batches of independent tasks. The calling thread
+ * works on each batch too, so a pool of N threads only starts N-1 workers.
+ */
+class ThreadPool {
+
+    public:
+
+        ThreadPool(int threadCount)
+        : generation(0), stopping(false), taskCount(0), busyWorkers(0) {
+            for (int i = 1; i < threadCount; i++) {
+                workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+            }
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+        }
+
+        int threadCount() const {
+            return workers.size() + 1;
+        }
+
+        /**
+         * @brief Runs task(i) for every i in [0, count), spread across the pool, and returns once
+         * all of them have finished. Tasks are handed out in increasing order of i. The task is
+         * called through a plain function pointer, so handing it to the workers never allocates.
+         */
+        template <typename Task> void parallelFor(int count, const Task& task) {
+            if (workers.empty() || count < 2) {
+                for (int i = 0; i < count; i++) {
+                    task(i);
+                }
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                currentTask = &task;
+                currentTrampoline = [](const void* taskObject, int i) {
+                    (*static_cast<const Task*>(taskObject))(i);
+                };
+                taskCount = count;
+                nextTask = 0;
+                busyWorkers = workers.size();
+                generation++;
+            }
+            wake.notify_all();
+
+            runTasks(&task, currentTrampoline, count);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this]() { return busyWorkers == 0; });
+            currentTask = nullptr;
+        }
+
+    private:
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        unsigned generation;
+        bool stopping;
+        typedef void (*Trampoline)(const void* task, int i);
+
+        const void* currentTask = nullptr;
+        Trampoline currentTrampoline = nullptr;
+        int taskCount;
+        std::atomic<int> nextTask;
+        size_t busyWorkers;
+
+        void runTasks(const void* task, Trampoline trampoline, int count) {
+            int i;
+            while ((i = nextTask.fetch_add(1)) < count) {
+                trampoline(task, i);
+            }
+        }
+
+        void workerLoop() {
+            unsigned seenGeneration = 0;
+            for (;;) {
+                const void* task;
+                Trampoline trampoline;
+                int count;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+                    if (stopping) {
+                        return;
+                    }
+                    seenGeneration = generation;
+                    task = currentTask;
+                    trampoline = currentTrampoline;
+                    count = taskCount;
+                }
+
+                runTasks(task, trampoline, count);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--busyWorkers == 0) {
+                    done.notify_one();
+                }
+            }
+        }
+
+};
+
+#endif
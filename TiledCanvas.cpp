@@ -0,0 +1,414 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#include "GCanvas.h"
+#include "GRect.h"
+#include "GBitmap.h"
+#include "GMatrix.h"
+#include "GShader.h"
+#include "GPath.h"
+#include "AdvancedCanvas.h"
+#include "ThreadPool.h"
+#include <stack>
+#include <vector>
+#include <algorithm>
+
+/**
+ * @brief One recorded draw, along with the CTM it was made under. Only the fields its type uses
+ * are filled in.
+ */
+struct TiledCommand {
+    enum Type {
+        kPaint,
+        kRect,
+        kConvexPolygon,
+        kPath,
+        kMesh,
+        kQuad,
+    };
+
+    Type type;
+    GMatrix ctm;
+    GPaint paint;
+    GRect rect;
+    GPath path;
+    std::vector<GPoint> points;
+    std::vector<GColor> colors;
+    std::vector<GPoint> texs;
+    int level = 0;
+
+    // A mesh's triangles split up by tile: each part holds the indices of the triangles touching
+    // one tile, in draw order, so the tile sets up only those.
+    std::vector<std::vector<int>> meshParts;
+};
+
+/**
+ * @brief One draw waiting in a tile's bin: the command to replay and, for a mesh, which of its
+ * parts falls in the tile.
+ */
+struct TiledBinEntry {
+    int command;
+    int meshPart;
+};
+
+class TiledCanvas : public GCanvas {
+public:
+
+    TiledCanvas(const GBitmap& device, int threadCount)
+        : fDevice(device), pool(threadCount),
+          tilesWide((device.width() + kTileSize - 1) / kTileSize),
+          tilesHigh((device.height() + kTileSize - 1) / kTileSize) {
+            transformationStack.push(GMatrix());
+
+            for (int ty = 0; ty < tilesHigh; ty++) {
+                for (int tx = 0; tx < tilesWide; tx++) {
+                    GIRect tile = GIRect::MakeLTRB(
+                        tx * kTileSize,
+                        ty * kTileSize,
+                        std::min((tx + 1) * kTileSize, device.width()),
+                        std::min((ty + 1) * kTileSize, device.height())
+                    );
+                    tileCanvases.push_back(GCreateClippedCanvas(fDevice, tile));
+                }
+            }
+            tileBins.resize(tileCanvases.size());
+            fullCanvas = GCreateBandedCanvas(fDevice, threadCount);
+    }
+
+    ~TiledCanvas() {
+        flush();
+    }
+
+    void save() override {
+        GMatrix ctm = transformationStack.top();
+        transformationStack.push(ctm);
+    }
+
+    void restore() override {
+        transformationStack.pop();
+    }
+
+    void concat(const GMatrix& matrix) override {
+        transformationStack.top() = GMatrix::Concat(transformationStack.top(), matrix);
+    }
+
+    void drawPaint(const GPaint& paint) override {
+        if (needsImmediateDraw(paint)) {
+            drawImmediately([&](GCanvas* canvas) { canvas->drawPaint(paint); });
+            return;
+        }
+        record(TiledCommand::kPaint, paint);
+        bin(GIRect::MakeWH(fDevice.width(), fDevice.height()));
+    }
+
+    void drawRect(const GRect& rect, const GPaint& paint) override {
+        if (needsImmediateDraw(paint)) {
+            drawImmediately([&](GCanvas* canvas) { canvas->drawRect(rect, paint); });
+            return;
+        }
+        TiledCommand& command = record(TiledCommand::kRect, paint);
+        command.rect = rect;
+
+        GPoint corners[4] = {
+            GPoint::Make(rect.left(), rect.top()),
+            GPoint::Make(rect.right(), rect.top()),
+            GPoint::Make(rect.right(), rect.bottom()),
+            GPoint::Make(rect.left(), rect.bottom()),
+        };
+        bin(deviceBounds(corners, 4));
+    }
+
+    void drawConvexPolygon(const GPoint points[], int count, const GPaint& paint) override {
+        if (count < 3) {
+            return;
+        }
+        if (needsImmediateDraw(paint)) {
+            drawImmediately([&](GCanvas* canvas) { canvas->drawConvexPolygon(points, count, paint); });
+            return;
+        }
+        TiledCommand& command = record(TiledCommand::kConvexPolygon, paint);
+        command.points.assign(points, points + count);
+        bin(deviceBounds(points, count));
+    }
+
+    void drawPath(const GPath& path, const GPaint& paint) override {
+        if (needsImmediateDraw(paint)) {
+            drawImmediately([&](GCanvas* canvas) { canvas->drawPath(path, paint); });
+            return;
+        }
+        TiledCommand& command = record(TiledCommand::kPath, paint);
+        command.path = path;
+
+        std::vector<GPoint> points;
+        GPath::Iter iter(path);
+        GPoint pts[GPath::kMaxNextPoints];
+        GPath::Verb verb;
+        while ((verb = iter.next(pts)) != GPath::kDone) {
+            switch (verb) {
+                case GPath::kMove:  points.push_back(pts[0]); break;
+                case GPath::kLine:  points.push_back(pts[1]); break;
+                case GPath::kQuad:  points.insert(points.end(), pts + 1, pts + 3); break;
+                case GPath::kCubic: points.insert(points.end(), pts + 1, pts + 4); break;
+                default: break;
+            }
+        }
+        bin(deviceBounds(points.data(), points.size()));
+    }
+
+    void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count,
+                  const int indices[], const GPaint& paint) override {
+        if (count < 1) {
+            return;
+        }
+        // Textured meshes point the paint's shader at each triangle in turn.
+        if (texs != nullptr && paint.getShader() != nullptr) {
+            drawImmediately([&](GCanvas* canvas) {
+                canvas->drawMesh(verts, colors, texs, count, indices, paint);
+            });
+            return;
+        }
+        TiledCommand& command = record(TiledCommand::kMesh, paint);
+        int commandIndex = commands.size() - 1;
+
+        int vertexCount = *std::max_element(indices, indices + (count * 3)) + 1;
+        command.points.assign(verts, verts + vertexCount);
+        if (colors != nullptr) {
+            command.colors.assign(colors, colors + vertexCount);
+        }
+        if (texs != nullptr) {
+            command.texs.assign(texs, texs + vertexCount);
+        }
+
+        // A mesh within one tile stays whole. Otherwise each triangle goes only to the tiles its
+        // own bounds touch, so a tile never sets up the triangles of a mesh that miss it.
+        GIRect bounds = deviceBounds(verts, vertexCount);
+        if (bounds.isEmpty()) {
+            commands.pop_back();
+            return;
+        }
+        if ((bounds.left() / kTileSize == (bounds.right() - 1) / kTileSize) &&
+            (bounds.top() / kTileSize == (bounds.bottom() - 1) / kTileSize)) {
+            command.meshParts.emplace_back(indices, indices + (count * 3));
+            bin(bounds, 0);
+            return;
+        }
+        std::vector<int> tileParts(tileCanvases.size(), -1);
+        for (int i = 0; i < count; i++) {
+            const int* corners = &indices[3 * i];
+            GPoint triangle[3] = { verts[corners[0]], verts[corners[1]], verts[corners[2]] };
+            forEachTile(deviceBounds(triangle, 3), [&](int tile) {
+                if (tileParts[tile] < 0) {
+                    tileParts[tile] = command.meshParts.size();
+                    command.meshParts.emplace_back();
+                    tileBins[tile].push_back({ commandIndex, tileParts[tile] });
+                }
+                std::vector<int>& part = command.meshParts[tileParts[tile]];
+                part.insert(part.end(), corners, corners + 3);
+            });
+        }
+        if (command.meshParts.empty()) {
+            commands.pop_back();
+        }
+    }
+
+    void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level,
+                  const GPaint& paint) override {
+        if (texs != nullptr && paint.getShader() != nullptr) {
+            drawImmediately([&](GCanvas* canvas) {
+                canvas->drawQuad(verts, colors, texs, level, paint);
+            });
+            return;
+        }
+        TiledCommand& command = record(TiledCommand::kQuad, paint);
+        command.level = level;
+        command.points.assign(verts, verts + 4);
+        if (colors != nullptr) {
+            command.colors.assign(colors, colors + 4);
+        }
+        if (texs != nullptr) {
+            command.texs.assign(texs, texs + 4);
+        }
+        // Every tessellated vertex is a blend of the corners, so the corners bound the mesh.
+        bin(deviceBounds(verts, 4));
+    }
+
+    /**
+     * @brief Rasterizes every recorded draw. Each tile replays its own commands in the order they
+     * were made, and tiles never share pixels, so the tiles can run on any thread in any order.
+     */
+    void flush() override {
+        if (commands.empty()) {
+            return;
+        }
+
+        pool.parallelFor(tileCanvases.size(), [this](int tile) {
+            GCanvas* canvas = tileCanvases[tile].get();
+            for (const TiledBinEntry& entry: tileBins[tile]) {
+                replay(commands[entry.command], entry.meshPart, canvas);
+            }
+            tileBins[tile].clear();
+        });
+        commands.clear();
+    }
+
+private:
+    // Tiles are square and this many pixels on a side, except along the right and bottom edges.
+    static const int kTileSize = 256;
+
+    // Recording is flushed once this many draws are pending, to bound memory.
+    static const size_t kMaxPendingCommands = 1 << 14;
+
+    // Note: we store a copy of the bitmap
+    const GBitmap fDevice;
+
+    ThreadPool pool;
+
+    const int tilesWide;
+    const int tilesHigh;
+
+    std::vector<std::unique_ptr<GCanvas>> tileCanvases;
+
+    // Every command touching each tile, in draw order.
+    std::vector<std::vector<TiledBinEntry>> tileBins;
+
+    std::vector<TiledCommand> commands;
+
+    // Draws that cannot be split across tiles go straight to this canvas, which can still split
+    // each of them into bands.
+    std::unique_ptr<GCanvas> fullCanvas;
+
+    std::stack<GMatrix> transformationStack;
+
+    /**
+     * @brief Shaders carry per-draw state from setContext(), so a draw that uses one cannot be
+     * shared between tiles. Such draws wait for the pending ones and then run on this thread.
+     */
+    bool needsImmediateDraw(const GPaint& paint) const {
+        return paint.getShader() != nullptr;
+    }
+
+    template <typename DrawProc> void drawImmediately(DrawProc drawProc) {
+        flush();
+        fullCanvas->save();
+        fullCanvas->concat(transformationStack.top());
+        drawProc(fullCanvas.get());
+        fullCanvas->restore();
+    }
+
+    TiledCommand& record(TiledCommand::Type type, const GPaint& paint) {
+        if (commands.size() >= kMaxPendingCommands) {
+            flush();
+        }
+        commands.emplace_back();
+        TiledCommand& command = commands.back();
+        command.type = type;
+        command.ctm = transformationStack.top();
+        command.paint = paint;
+        return command;
+    }
+
+    /**
+     * @brief Returns the device pixels that the given local points could touch under the CTM,
+     * padded by a pixel on each side to cover rounding and partial coverage.
+     */
+    GIRect deviceBounds(const GPoint points[], int count) const {
+        if (count < 1) {
+            return GIRect::MakeWH(0, 0);
+        }
+        const GMatrix& ctm = transformationStack.top();
+
+        float left = fDevice.width();
+        float top = fDevice.height();
+        float right = 0;
+        float bottom = 0;
+        for (int i = 0; i < count; i++) {
+            GPoint p;
+            ctm.mapPoints(&p, &points[i], 1);
+            left = std::min(left, p.x());
+            top = std::min(top, p.y());
+            right = std::max(right, p.x());
+            bottom = std::max(bottom, p.y());
+        }
+        left = std::max(left, 0.0f);
+        top = std::max(top, 0.0f);
+        right = std::min(right, (float) fDevice.width());
+        bottom = std::min(bottom, (float) fDevice.height());
+
+        return GIRect::MakeLTRB(
+            std::max(GFloorToInt(left) - 1, 0),
+            std::max(GFloorToInt(top) - 1, 0),
+            std::min(GCeilToInt(right) + 1, fDevice.width()),
+            std::min(GCeilToInt(bottom) + 1, fDevice.height())
+        );
+    }
+
+    //Adds the most recently recorded command, or the given part of it, to every tile that bounds overlaps.
+    void bin(const GIRect& bounds, int meshPart = -1) {
+        if (bounds.isEmpty()) {
+            commands.pop_back();
+            return;
+        }
+        int index = commands.size() - 1;
+        forEachTile(bounds, [&](int tile) {
+            tileBins[tile].push_back({ index, meshPart });
+        });
+    }
+
+    //Calls tileProc with the index of every tile that bounds overlaps.
+    template <typename TileProc> void forEachTile(const GIRect& bounds, TileProc tileProc) const {
+        if (bounds.isEmpty()) {
+            return;
+        }
+        int txLast = (bounds.right() - 1) / kTileSize;
+        int tyLast = (bounds.bottom() - 1) / kTileSize;
+        for (int ty = bounds.top() / kTileSize; ty <= tyLast; ty++) {
+            for (int tx = bounds.left() / kTileSize; tx <= txLast; tx++) {
+                tileProc((ty * tilesWide) + tx);
+            }
+        }
+    }
+
+    static void replay(const TiledCommand& command, int meshPart, GCanvas* canvas) {
+        canvas->save();
+        canvas->concat(command.ctm);
+
+        const GColor* colors = command.colors.empty() ? nullptr : command.colors.data();
+        const GPoint* texs = command.texs.empty() ? nullptr : command.texs.data();
+
+        switch (command.type) {
+            case TiledCommand::kPaint:
+                canvas->drawPaint(command.paint);
+                break;
+            case TiledCommand::kRect:
+                canvas->drawRect(command.rect, command.paint);
+                break;
+            case TiledCommand::kConvexPolygon:
+                canvas->drawConvexPolygon(command.points.data(), command.points.size(), command.paint);
+                break;
+            case TiledCommand::kPath:
+                canvas->drawPath(command.path, command.paint);
+                break;
+            case TiledCommand::kMesh: {
+                const std::vector<int>& indices = command.meshParts[meshPart];
+                canvas->drawMesh(command.points.data(), colors, texs, indices.size() / 3,
+                                 indices.data(), command.paint);
+                break;
+            }
+            case TiledCommand::kQuad:
+                canvas->drawQuad(command.points.data(), colors, texs, command.level, command.paint);
+                break;
+        }
+
+        canvas->restore();
+    }
+
+};
+
+std::unique_ptr<GCanvas> GCreateTiledCanvas(const GBitmap& device, int threadCount) {
+    if (device.width() < 1 || device.height() < 1 || threadCount < 1) {
+        return nullptr;
+    }
+    return std::unique_ptr<GCanvas>(new TiledCanvas(device, threadCount));
+}
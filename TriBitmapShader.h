@@ -0,0 +1,88 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef TriBitmapShader_DEFINED
+#define TriBitmapShader_DEFINED
+
+#include "GShader.h"
+#include "GBitmap.h"
+#include "GMatrix.h"
+#include "GPoint.h"
+#include "BlendFunctions.h"
+#include <iostream>
+
+class TriBitmapShader final : public GShader {
+
+public:
+
+    TriBitmapShader (GShader* shader) : shader(shader) {}
+
+    TriBitmapShader (GPoint triPoints[], GPoint texPoints[], GShader* shader) : shader(shader) {
+        setTriangle(triPoints, texPoints);
+    }
+
+    /**
+     * @brief Maps the texture onto a new triangle, so one shader can texture every triangle of a
+     * mesh in turn. The wrapped shader only sees the new mapping at the next setContext.
+     */
+    void setTriangle(const GPoint triPoints[], const GPoint texPoints[]) {
+        GPoint p0 = triPoints[0];
+        GPoint p1 = triPoints[1];
+        GPoint p2 = triPoints[2];
+
+        GPoint t0 = texPoints[0];
+        GPoint t1 = texPoints[1];
+        GPoint t2 = texPoints[2];
+
+        float px1 = p1.x() - p0.x();
+        float py1 = p1.y() - p0.y();
+        float px2 = p2.x() - p0.x();
+        float py2 = p2.y() - p0.y();
+
+        float tx1 = t1.x() - t0.x();
+        float ty1 = t1.y() - t0.y();
+        float tx2 = t2.x() - t0.x();
+        float ty2 = t2.y() - t0.y();
+
+        GMatrix P = GMatrix(
+            px1,px2, p0.x(),
+            py1,py2, p0.y()
+        );
+
+        GMatrix T = GMatrix(
+            tx1,tx2, t0.x(),
+            ty1,ty2, t0.y()
+        );
+
+        GMatrix invT;
+        T.invert(&invT);
+        lm = GMatrix::Concat(P,invT);
+    }
+
+    bool isOpaque() {
+        return shader->isOpaque();
+    }
+
+    bool canShadeConcurrently() {
+        return shader->canShadeConcurrently();
+    }
+
+    bool setContext(const GMatrix& ctm) {
+        return(this->shader->setContext(GMatrix::Concat(ctm, lm)));
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) {
+        this->shader->shadeRow(x,y,count,row);
+    }
+    
+
+private:
+
+    GMatrix lm;
+    GShader* shader;
+
+};
+
+#endif
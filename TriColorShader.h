@@ -0,0 +1,242 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef TriColorShader_DEFINED
+#define TriColorShader_DEFINED
+
+#include "GShader.h"
+#include "GBitmap.h"
+#include "GMatrix.h"
+#include "GPoint.h"
+#include "BlendFunctions.h"
+#include "BlendSpans.h"
+#include "MathUtil.h"
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+class TriColorShader final : public GShader {
+
+public:
+
+    TriColorShader () {}
+
+    TriColorShader (GPoint points[], GColor color[]) {
+        setTriangle(points, color);
+    }
+
+    /**
+     * @brief Points the shader at a new triangle, so one shader can color every triangle of a
+     * mesh in turn. Colors must already be premultiplied. setContext must be called again before
+     * the next shadeRow.
+     */
+    void setTriangle(const GPoint points[], const GColor color[]) {
+        GPoint p0 = points[0];
+        GPoint p1 = points[1];
+        GPoint p2 = points[2];
+        float x1 = p1.x() - p0.x();
+        float y1 = p1.y() - p0.y();
+        float x2 = p2.x() - p0.x();
+        float y2 = p2.y() - p0.y();
+
+        lm = GMatrix(
+            x1,x2, p0.x(),
+            y1,y2, p0.y());
+        tm=lm;
+        c0 = color[0];
+        c1 = color[1];
+        c2 = color[2];
+        opaque = c0.a >= 1 && c1.a >= 1 && c2.a >= 1;
+    }
+
+    bool isOpaque() {
+        return opaque;
+    }
+
+    bool canShadeConcurrently() {
+        return true;
+    }
+
+    /**
+     * @brief Works out the triangle's color as a plane over device space: its value in 0..255
+     * units at the device origin and how much it changes per pixel across and down.
+     */
+    bool setContext(const GMatrix& ctm) {
+        if (!GMatrix::Concat(ctm, lm).invert(&tm)) {
+            return false;
+        }
+        const float c0Lanes[kLanes] = { c0.b, c0.g, c0.r, c0.a };
+        const float c1Lanes[kLanes] = { c1.b, c1.g, c1.r, c1.a };
+        const float c2Lanes[kLanes] = { c2.b, c2.g, c2.r, c2.a };
+        for (int k = 0; k < kLanes; k++) {
+            float d1 = (c1Lanes[k] - c0Lanes[k]) * 255;
+            float d2 = (c2Lanes[k] - c0Lanes[k]) * 255;
+            origin[k] = (c0Lanes[k] * 255) + (tm[GMatrix::TX] * d1) + (tm[GMatrix::TY] * d2);
+            dx[k] = (tm[GMatrix::SX] * d1) + (tm[GMatrix::KY] * d2);
+            dy[k] = (tm[GMatrix::KX] * d1) + (tm[GMatrix::SY] * d2);
+        }
+        return true;
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) {
+        stepColors(x, y, count, [&](int i, GPixel color) {
+            row[i] = color;
+        });
+    }
+
+    /**
+     * @brief Multiplies the count pixels already in row by the triangle's colors under them, in
+     * the same pass that steps the colors, as a textured triangle's vertex colors tint it.
+     */
+    void modulateRow(int x, int y, int count, GPixel row[]) {
+        stepColors(x, y, count, [&](int i, GPixel color) {
+            row[i] = modulatePixel(row[i], color);
+        });
+    }
+
+private:
+
+    /**
+     * @brief Calls colorProc(i, color) for each pixel i of the row [x, x + count) on row y.
+     * Steps the color across the row in 16.16 fixed point, all four channels at once, from its
+     * value at device column 0, so a pixel gets the same color whichever span of the row it is
+     * shaded in. Which way the row is stepped depends only on the row, never on the span.
+     * Pixels beyond the triangle's corners can extrapolate past 0..255 or above alpha, so every
+     * pixel is pinned back, which costs nothing beyond the packing that SSE2 saturates anyway.
+     */
+    template <typename ColorProc> void stepColors(int x, int y, int count, ColorProc colorProc) {
+        // The row's value at the center of device column 0, which every span of the row steps from.
+        float cy = y + 0.5f;
+        float rowOrigin[kLanes];
+
+#if defined(__SSE2__)
+        const __m128 dxLanes = _mm_loadu_ps(dx);
+        __m128 rowLanes = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(origin), _mm_mul_ps(_mm_loadu_ps(dy), _mm_set1_ps(cy))),
+                                     _mm_mul_ps(dxLanes, _mm_set1_ps(0.5f)));
+        _mm_storeu_ps(rowOrigin, rowLanes);
+        __m128 first = _mm_add_ps(rowLanes, _mm_mul_ps(dxLanes, _mm_set1_ps((float) x)));
+        __m128 last = _mm_add_ps(first, _mm_mul_ps(dxLanes, _mm_set1_ps((float) count)));
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        const __m128 limit = _mm_set1_ps(kMaxFixedValue);
+        __m128 rowFits = _mm_cmplt_ps(_mm_andnot_ps(signBit, rowLanes), limit);
+        __m128 spanFits = _mm_and_ps(_mm_cmplt_ps(_mm_andnot_ps(signBit, first), limit),
+                                     _mm_cmplt_ps(_mm_andnot_ps(signBit, last), limit));
+        if (_mm_movemask_ps(rowFits) == 0xF) {
+            if (_mm_movemask_ps(spanFits) == 0xF) {
+                // Half a unit up front turns the flooring shift below into rounding. Stepping out
+                // to x can wrap 32 bits on the way, but lands back on the value at x, which fits.
+                const __m128i dv = _mm_cvtps_epi32(_mm_mul_ps(dxLanes, _mm_set1_ps(65536)));
+                __m128i v = _mm_cvtps_epi32(_mm_mul_ps(_mm_add_ps(rowLanes, _mm_set1_ps(0.5f)), _mm_set1_ps(65536)));
+                v = _mm_add_epi32(v, mulLanes(dv, x));
+                for (int i = 0; i < count; i++) {
+                    __m128i c = _mm_packs_epi32(_mm_srai_epi32(v, 16), _mm_setzero_si128());
+                    c = _mm_min_epi16(c, _mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3)));
+                    colorProc(i, (GPixel) _mm_cvtsi128_si32(_mm_packus_epi16(c, c)));
+                    v = _mm_add_epi32(v, dv);
+                }
+                return;
+            }
+        } else if (stepFromRowOrigin(rowOrigin, x, count, colorProc)) {
+            return;
+        }
+#else
+        for (int k = 0; k < kLanes; k++) {
+            rowOrigin[k] = origin[k] + (dy[k] * cy) + (dx[k] * 0.5f);
+        }
+        if (stepFromRowOrigin(rowOrigin, x, count, colorProc)) {
+            return;
+        }
+#endif
+
+        // Far outside the triangle the plane overflows 16.16, so step it in float instead.
+        for (int i = 0; i < count; i++) {
+            int c[kLanes];
+            for (int k = 0; k < kLanes; k++) {
+                c[k] = std::max(0, std::min(GRoundToInt(rowOrigin[k] + (dx[k] * (x + i))), 255));
+            }
+            colorProc(i, packPinned(c));
+        }
+    }
+
+    /**
+     * @brief Steps the row [x, x + count) in 16.16 fixed point from rowOrigin, its value at device
+     * column 0, stepping out to x in 64 bits since rowOrigin itself may not fit in 16.16. Returns
+     * false, shading nothing, when the row overflows 16.16 within the span.
+     */
+    template <typename ColorProc>
+    bool stepFromRowOrigin(const float rowOrigin[], int x, int count, ColorProc colorProc) {
+        GFixed value[kLanes];
+        GFixed step[kLanes];
+        for (int k = 0; k < kLanes; k++) {
+            if (std::abs(rowOrigin[k]) >= kMaxRowOrigin || std::abs(dx[k]) >= kMaxFixedValue) {
+                return false;
+            }
+            step[k] = (GFixed) floorToInt64((dx[k] * 65536.0) + 0.5);
+            int64_t first = floorToInt64((rowOrigin[k] + 0.5) * 65536.0) + ((int64_t) step[k] * x);
+            int64_t last = first + ((int64_t) step[k] * count);
+            if (std::abs(first) >= kMaxFixed || std::abs(last) >= kMaxFixed) {
+                return false;
+            }
+            value[k] = (GFixed) first;
+        }
+
+        for (int i = 0; i < count; i++) {
+            int c[kLanes];
+            for (int k = 0; k < kLanes; k++) {
+                c[k] = std::max(0, std::min(value[k] >> 16, 255));
+                value[k] += step[k];
+            }
+            colorProc(i, packPinned(c));
+        }
+        return true;
+    }
+
+    // Channels in the order they sit in a GPixel, lowest byte first: blue, green, red, alpha.
+    static const int kLanes = 4;
+
+    // Past this many 0..255 units a channel's plane could overflow 16.16 fixed point.
+    static constexpr float kMaxFixedValue = 16384;
+    static constexpr int64_t kMaxFixed = (int64_t) 16384 << 16;
+
+    // Past this many units at device column 0, stepping a row out to any pixel could overflow
+    // 64 bits, so it is only stepped in float.
+    static constexpr float kMaxRowOrigin = 1e12f;
+
+    GMatrix tm;
+    GMatrix lm;
+    GColor c0;
+    GColor c1;
+    GColor c2;
+    bool opaque = false;
+
+    float origin[kLanes];
+    float dx[kLanes];
+    float dy[kLanes];
+
+#if defined(__SSE2__)
+    // Multiplies each 32-bit lane of v by n, keeping the low 32 bits, which SSE2 has no single
+    // instruction for.
+    static __m128i mulLanes(__m128i v, int n) {
+        const __m128i scale = _mm_set1_epi32(n);
+        __m128i even = _mm_mul_epu32(v, scale);
+        __m128i odd = _mm_mul_epu32(_mm_srli_si128(v, 4), scale);
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+#endif
+
+    // Packs channels already pinned to 0..255, in lane order, pinning each color to alpha.
+    static GPixel packPinned(const int c[kLanes]) {
+        return GPixel_PackARGB(c[3], std::min(c[2], c[3]), std::min(c[1], c[3]), std::min(c[0], c[3]));
+    }
+
+};
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ *  @author William Convertino
+ *  @copyright 2022
+ */
+
+#ifndef TriangleRasterizer_DEFINED
+#define TriangleRasterizer_DEFINED
+
+#include "GPoint.h"
+#include "GRect.h"
+#include "Edge.h"
+#include "MathUtil.h"
+#include "Blitter.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Scan converts single triangles straight from their three device-space vertices, with no
+ * path, edge list or winding count in between.
+ *
+ * Pixels follow the top-left rule: a pixel is drawn when its center lies inside the triangle, or
+ * exactly on a top or left edge. Centers on a bottom or right edge belong to the neighbouring
+ * triangle instead, so a mesh covers every pixel along a shared edge exactly once.
+ */
+class TriangleRasterizer {
+
+    public:
+
+        /**
+         * @brief Returns true if every vertex is small enough for 16.16 edge stepping. Larger
+         * triangles have to go through the general path filler instead.
+         */
+        static bool canRasterize(const GPoint pts[3]) {
+            for (int i = 0; i < 3; i++) {
+                if (!(std::abs(pts[i].x()) < kMaxCoordinate && std::abs(pts[i].y()) < kMaxCoordinate)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Calls spanProc(y, left, right) for each row of the triangle that falls inside the
+         * clip, with [left, right) already trimmed to the clip. Rows arrive from top to bottom.
+         */
+        template <typename SpanProc> static void rasterize(const GPoint pts[3], const GIRect& clip, SpanProc spanProc) {
+            // Sort the vertices from top to bottom. Ties are broken on x so that two triangles
+            // sharing an edge always set it up from the same end, and so step it identically.
+            const GPoint* v[3] = { &pts[0], &pts[1], &pts[2] };
+            std::sort(v, v + 3, [](const GPoint* a, const GPoint* b) {
+                return a->y() < b->y() || (a->y() == b->y() && a->x() < b->x());
+            });
+            const GPoint& top = *v[0];
+            const GPoint& mid = *v[1];
+            const GPoint& bottom = *v[2];
+
+            // Which side of the long edge (top to bottom) the middle vertex falls on.
+            double cross = ((double) mid.x() - top.x()) * ((double) bottom.y() - top.y()) -
+                           ((double) mid.y() - top.y()) * ((double) bottom.x() - top.x());
+            if (cross == 0) {
+                return;
+            }
+            bool longEdgeOnLeft = cross > 0;
+
+            Edge longEdge = makeTriangleEdge(top, bottom);
+            Edge shortEdges[2] = { makeTriangleEdge(top, mid), makeTriangleEdge(mid, bottom) };
+
+            int y = std::max(longEdge.yTop, clip.top());
+            int yEnd = std::min(longEdge.yBottom, clip.bottom());
+            if (y >= yEnd) {
+                return;
+            }
+            advanceEdge(longEdge, y - longEdge.yTop);
+
+            for (Edge& shortEdge: shortEdges) {
+                int rowEnd = std::min(shortEdge.yBottom, yEnd);
+                if (y >= rowEnd) {
+                    continue;
+                }
+                advanceEdge(shortEdge, y - shortEdge.yTop);
+
+                Edge& left = longEdgeOnLeft ? longEdge : shortEdge;
+                Edge& right = longEdgeOnLeft ? shortEdge : longEdge;
+                for (; y < rowEnd; y++) {
+                    int l = std::max(getCurrentX(left), clip.left());
+                    int r = std::min(getCurrentX(right), clip.right());
+                    if (l < r) {
+                        spanProc(y, l, r);
+                    }
+                    stepEdge(left);
+                    stepEdge(right);
+                }
+            }
+        }
+
+        /**
+         * @brief Fills the triangle's rows inside the clip into blitter.
+         */
+        static void blit(const GPoint pts[3], const GIRect& clip, Blitter& blitter) {
+            rasterize(pts, clip, [&](int y, int left, int right) {
+                blitter.blitH(left, y, right - left);
+            });
+        }
+
+    private:
+
+        // Keeps x within 16.16 range after stepping across any row of the triangle.
+        static constexpr float kMaxCoordinate = 16384;
+
+        /**
+         * @brief Sets up the edge from p0 down to p1. Its rows are those whose centers satisfy
+         * p0.y <= center < p1.y, and its x is biased so that x >> 16 is the first column whose
+         * center is at or right of the edge.
+         */
+        static Edge makeTriangleEdge(const GPoint& p0, const GPoint& p1) {
+            Edge edge;
+            edge.yTop = (int) std::ceil(p0.y() - 0.5);
+            edge.yBottom = (int) std::ceil(p1.y() - 0.5);
+            edge.orientation = 0;
+
+            double dy = (double) p1.y() - p0.y();
+            double slope = dy > 0 ? ((double) p1.x() - p0.x()) / dy : 0;
+            double x = p0.x() + (((edge.yTop + 0.5) - p0.y()) * slope);
+
+            edge.x = doubleToFixed(x - 0.5) + 0xFFFF;
+            edge.dx = edgeStepToFixed(slope, edge.yTop, edge.yBottom);
+            return edge;
+        }
+
+};
+
+#endif
@@ -6,9 +6,14 @@
 #include "GCanvas.h"
 #include "GBitmap.h"
 #include "GTime.h"
+#include "../AdvancedCanvas.h"
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <new>
 #include <string>
 #include <vector>
+#include <cstdlib>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -23,11 +28,14 @@ enum Mode {
     kOnce,
 };
 
-static double handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap, Mode mode) {
+typedef std::function<std::unique_ptr<GCanvas>(const GBitmap&)> CanvasFactory;
+
+static double handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap, Mode mode,
+                          const CanvasFactory& factory = GCreateCanvas) {
     GISize size = bench->size();
     setup_bitmap(bitmap, size.fWidth, size.fHeight);
 
-    auto canvas = GCreateCanvas(*bitmap);
+    auto canvas = factory(*bitmap);
     if (!canvas) {
         fprintf(stderr, "failed to create canvas for [%d %d] %s\n",
                 size.fWidth, size.fHeight, bench->name());
@@ -45,11 +53,110 @@ static double handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap,
     GMSec now = GTime::GetMSec();
     for (int i = 0; i < N || forever; ++i) {
         bench->draw(canvas.get());
+        canvas->flush();
     }
     GMSec dur = GTime::GetMSec() - now;
     return dur * 1.0 / N;
 }
 
+// Every heap allocation in the process, so --allocs can report how many a draw makes.
+static std::atomic<long> gAllocCount(0);
+
+void* operator new(size_t size) {
+    gAllocCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+/*
+ *  Forwards every call to another canvas, counting the heap allocations made inside it, so
+ *  that allocations the bench makes while building its geometry are left out.
+ */
+class AllocCountingCanvas : public GCanvas {
+    GCanvas* fCanvas;
+
+    struct Scope {
+        long& fCount;
+        long fStart;
+        Scope(long& count) : fCount(count), fStart(gAllocCount.load()) {}
+        ~Scope() { fCount += gAllocCount.load() - fStart; }
+    };
+
+public:
+    long fAllocs = 0;
+
+    AllocCountingCanvas(GCanvas* canvas) : fCanvas(canvas) {}
+
+    void save() override { Scope s(fAllocs); fCanvas->save(); }
+    void restore() override { Scope s(fAllocs); fCanvas->restore(); }
+    void concat(const GMatrix& m) override { Scope s(fAllocs); fCanvas->concat(m); }
+    void flush() override { Scope s(fAllocs); fCanvas->flush(); }
+    void drawPaint(const GPaint& p) override { Scope s(fAllocs); fCanvas->drawPaint(p); }
+    void drawRect(const GRect& r, const GPaint& p) override { Scope s(fAllocs); fCanvas->drawRect(r, p); }
+    void drawConvexPolygon(const GPoint pts[], int count, const GPaint& p) override {
+        Scope s(fAllocs);
+        fCanvas->drawConvexPolygon(pts, count, p);
+    }
+    void drawPath(const GPath& path, const GPaint& p) override { Scope s(fAllocs); fCanvas->drawPath(path, p); }
+    void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count,
+                  const int indices[], const GPaint& p) override {
+        Scope s(fAllocs);
+        fCanvas->drawMesh(verts, colors, texs, count, indices, p);
+    }
+    void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level,
+                  const GPaint& p) override {
+        Scope s(fAllocs);
+        fCanvas->drawQuad(verts, colors, texs, level, p);
+    }
+};
+
+// Returns the heap allocations the canvas makes during one draw of the bench, once a few draws
+// have warmed up whatever the canvas reuses.
+static long count_allocs(GBenchmark* bench) {
+    GISize size = bench->size();
+    GBitmap bitmap;
+    setup_bitmap(&bitmap, size.fWidth, size.fHeight);
+    auto canvas = GCreateCanvas(bitmap);
+
+    for (int i = 0; i < 3; ++i) {
+        bench->draw(canvas.get());
+    }
+    AllocCountingCanvas counter(canvas.get());
+    bench->draw(&counter);
+    counter.flush();
+
+    free(bitmap.pixels());
+    return counter.fAllocs;
+}
+
+// Prints how many of one draw of the bench's draws were simplified because of their source's
+// opacity: reduced to Src or Clear, skipped, or filled with plain stores.
+static void print_reductions(GBenchmark* bench) {
+    GISize size = bench->size();
+    GBitmap bitmap;
+    setup_bitmap(&bitmap, size.fWidth, size.fHeight);
+    auto canvas = GCreateCanvas(bitmap);
+
+    GResetBlendReductionStats();
+    bench->draw(canvas.get());
+    canvas->flush();
+    GBlendReductionStats stats = GGetBlendReductionStats();
+    printf(" src:%ld clear:%ld skip:%ld store:%ld",
+           stats.reducedToSrc, stats.reducedToClear, stats.elided, stats.solidStores);
+
+    free(bitmap.pixels());
+}
+
 static bool is_arg(const char arg[], const char name[]) {
     std::string str("--");
     str += name;
@@ -88,6 +195,9 @@ int main(int argc, char** argv) {
     std::vector<double> inScores;
     bool chatty_mode = true;
     bool write_images = false;
+    int maxThreads = 0;
+    bool count_allocations = false;
+    bool show_reductions = false;
 
     int count = -1;
     while (gBenchFactories[++count]);
@@ -112,6 +222,12 @@ int main(int argc, char** argv) {
             chatty_mode = false;
         } else if (is_arg(argv[i], "writeImages")) {
             write_images = true;
+        } else if (is_arg(argv[i], "threads") && i+1 < argc) {
+            maxThreads = atoi(argv[++i]);
+        } else if (is_arg(argv[i], "allocs")) {
+            count_allocations = true;
+        } else if (is_arg(argv[i], "reductions")) {
+            show_reductions = true;
         } else {
             printf("Unknown arg %s\n", argv[i]);
             return -1;
@@ -123,6 +239,16 @@ int main(int argc, char** argv) {
         return -1;
     }
 
+    // With --threads N, each bench is also timed at 1, 2, 4 ... N threads, on the tiled canvas (t)
+    // and on a canvas that splits each draw into bands (b).
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    if (maxThreads > 0) {
+        threadCounts.push_back(maxThreads);
+    }
+
     std::vector<double> durs;
     double quotient = 0;
     for (int i = 0; i < count; ++i) {
@@ -138,6 +264,29 @@ int main(int argc, char** argv) {
         if (chatty_mode) {
             printf("%s %g", name, dur);
         }
+
+        for (int threads: threadCounts) {
+            GBitmap tiledBM;
+            double tiledDur = handle_proc(bench.get(), name, &tiledBM, mode, [threads](const GBitmap& bm) {
+                return GCreateTiledCanvas(bm, threads);
+            });
+            GBitmap bandedBM;
+            double bandedDur = handle_proc(bench.get(), name, &bandedBM, mode, [threads](const GBitmap& bm) {
+                return GCreateBandedCanvas(bm, threads);
+            });
+            if (chatty_mode) {
+                printf(" t%d:%g b%d:%g", threads, tiledDur, threads, bandedDur);
+            }
+            free(tiledBM.pixels());
+            free(bandedBM.pixels());
+        }
+
+        if (count_allocations && chatty_mode) {
+            printf(" allocs:%ld", count_allocs(bench.get()));
+        }
+        if (show_reductions && chatty_mode) {
+            print_reductions(bench.get());
+        }
         if (inScores.size()) {
             if (chatty_mode) {
                 printf(" %g [%.2f]", inScores[i], dur / inScores[i]);
@@ -8,6 +8,8 @@
 #include "GColor.h"
 #include "GRandom.h"
 #include "GRect.h"
+#include "GShader.h"
+#include "../AdvancedShaders.h"
 #include <string>
 
 static GColor rand_color(GRandom& rand, bool forceOpaque = false) {
@@ -74,6 +76,243 @@ public:
 #include "bench_pa5.inc"
 #include "bench_pa6.inc"
 
+struct ARGB {
+    float a, r, g, b;
+
+    operator GColor() const { return GColor{r, g, b, a}; }
+};
+
+class LionBench : public GBenchmark {
+    const float fScale;
+    const char* fName;
+    const GISize fSize;
+public:
+    LionBench(float scale, const char* name, GISize size = { 512, 512 })
+        : fScale(scale), fName(name), fSize(size) {}
+
+    const char* name() const override { return fName; }
+    GISize size() const override { return fSize; }
+    void draw(GCanvas* canvas) override {
+        const int N = 10;
+        canvas->save();
+        canvas->scale(fScale, fScale);
+        for (int i = 0; i < N; ++i) {
+#include "lion.inc"
+        }
+        canvas->restore();
+    }
+};
+
+/*
+ *  A field of curved shapes seen through a zoom, so that most of each path lies off the canvas.
+ */
+class CurveZoomBench : public GBenchmark {
+    enum { W = 256, H = 256 };
+    const float fZoom;
+    const char* fName;
+    GPath       fPath;
+public:
+    CurveZoomBench(float zoom, const char* name) : fZoom(zoom), fName(name) {
+        GRandom rand;
+        for (int i = 0; i < 100; ++i) {
+            GPoint center = { rand.nextF() * W, rand.nextF() * H };
+            fPath.addCircle(center, 10 + rand.nextF() * 100, GPath::kCW_Direction);
+            fPath.moveTo(center).cubicTo({ rand.nextF() * W, rand.nextF() * H },
+                                         { rand.nextF() * W, rand.nextF() * H },
+                                         { rand.nextF() * W, rand.nextF() * H });
+        }
+    }
+
+    const char* name() const override { return fName; }
+    GISize size() const override { return { W, H }; }
+    void draw(GCanvas* canvas) override {
+        const int N = 10;
+        GPaint paint({ 1, 0.25f, 0.5f, 0.75f });
+        canvas->save();
+        canvas->translate(W / 2, H / 2);
+        canvas->scale(fZoom, fZoom);
+        canvas->translate(-W / 2, -H / 2);
+        for (int i = 0; i < N; ++i) {
+            canvas->drawPath(fPath, paint);
+        }
+        canvas->restore();
+    }
+};
+
+/*
+ *  Blends a translucent rect over a translucent background in a single blend mode, with either a
+ *  solid color or a per-pixel gradient as the source.
+ */
+class BlendModeBench : public GBenchmark {
+    enum { W = 256, H = 256 };
+    const GBlendMode fMode;
+    const bool       fShaded;
+    std::string      fName;
+public:
+    BlendModeBench(GBlendMode mode, bool shaded) : fMode(mode), fShaded(shaded) {
+        static const char* const gNames[] = {
+            "clear", "src", "dst", "srcover", "dstover", "srcin",
+            "dstin", "srcout", "dstout", "srcatop", "dstatop", "xor",
+        };
+        fName = std::string("blend_") + gNames[(int)mode] + (shaded ? "_shader" : "");
+    }
+
+    const char* name() const override { return fName.c_str(); }
+    GISize size() const override { return { W, H }; }
+    void draw(GCanvas* canvas) override {
+        const GRect r = GRect::MakeWH(W, H);
+        const GColor colors[] = {{ 1, 0, 0, 0.25f }, { 0, 0.5f, 1, 0.75f }};
+        auto shader = GCreateLinearGradient({0, 0}, GPoint{W, H}, colors, 2);
+
+        GPaint paint({ 0.25f, 0.5f, 0.75f, 0.5f });
+        if (fShaded) {
+            paint.setShader(shader.get());
+        }
+        paint.setBlendMode(fMode);
+        for (int i = 0; i < 20; ++i) {
+            canvas->drawRect(r, GPaint({ 0, 0.5f, 1, 0.5f }));
+            canvas->drawRect(r, paint);
+        }
+    }
+};
+
+/*
+ *  Draws a colored quad at a fixed tessellation level.
+ */
+class QuadBench : public GBenchmark {
+    const int   fLevel;
+    const char* fName;
+public:
+    QuadBench(int level, const char name[]) : fLevel(level), fName(name) {}
+
+    const char* name() const override { return fName; }
+    GISize size() const override { return { 256, 256 }; }
+    void draw(GCanvas* canvas) override {
+        const GPoint verts[] = {{10, 20}, {240, 5}, {250, 250}, {0, 230}};
+        const GColor colors[] = {{1, 1, 0, 0}, {1, 0, 1, 0}, {1, 0, 0, 1}, {1, 1, 1, 1}};
+        for (int i = 0; i < 10; ++i) {
+            canvas->drawQuad(verts, colors, nullptr, fLevel, GPaint());
+        }
+    }
+};
+
+/*
+ *  A ShaderBench filling its canvas with one of the gradient shapes beyond linear.
+ */
+class GradientShapeBench : public ShaderBench {
+public:
+    GradientShapeBench(std::unique_ptr<GShader> shader, const char* name) : ShaderBench(name, 20) {
+        fShader = std::move(shader);
+    }
+};
+
+/*
+ *  A BitmapBench sampling its bitmap through the bilinear filter.
+ */
+class BilerpBench : public ShaderBench {
+public:
+    BilerpBench(const char imagePath[], const char* name, GShader::TileMode tm = GShader::kClamp)
+        : ShaderBench(name, 50)
+    {
+        GBitmap bm;
+        bm.readFromFile(imagePath);
+        GMatrix mx = GMatrix::Scale(W * 1.0 / bm.width(), H * 1.0 / bm.height());
+        fShader = GCreateBilerpShader(bm, mx, tm, MipMap::kNearest);
+    }
+};
+
+/*
+ *  Draws a bitmap of noise shrunk by a whole factor onto a small canvas, as a thumbnail would,
+ *  sampling it nearest or, when trilinear, filtered between two mip levels.
+ */
+class DownscaleBench : public GBenchmark {
+    enum { W = 64, H = 64 };
+    const char*     fName;
+    GBitmap         fBitmap;
+    std::unique_ptr<GShader> fShader;
+public:
+    DownscaleBench(int factor, bool trilinear, const char* name) : fName(name) {
+        fBitmap.alloc(W * factor, H * factor);
+        GRandom rand;
+        for (int y = 0; y < fBitmap.height(); ++y) {
+            GPixel* row = fBitmap.getAddr(0, y);
+            for (int x = 0; x < fBitmap.width(); ++x) {
+                row[x] = GPixel_PackARGB(255, rand.nextU() & 0xFF, rand.nextU() & 0xFF, rand.nextU() & 0xFF);
+            }
+        }
+        GMatrix mx = GMatrix::Scale(1.0f / factor, 1.0f / factor);
+        if (trilinear) {
+            fShader = GCreateBilerpShader(fBitmap, mx, GShader::kClamp, MipMap::kLinear);
+        } else {
+            fShader = GCreateBitmapShader(fBitmap, mx);
+        }
+    }
+    ~DownscaleBench() override {
+        free(fBitmap.pixels());
+    }
+
+    const char* name() const override { return fName; }
+    GISize size() const override { return { W, H }; }
+    void draw(GCanvas* canvas) override {
+        GPaint paint(fShader.get());
+        for (int i = 0; i < 20; ++i) {
+            canvas->drawPaint(paint);
+        }
+    }
+};
+
+/*
+ *  Forwards every draw to another canvas with anti-aliasing turned on in the paint.
+ */
+class AntiAliasCanvas : public GCanvas {
+    GCanvas* fCanvas;
+
+    static GPaint aa(const GPaint& paint) {
+        GPaint p(paint);
+        p.setAntiAlias(true);
+        return p;
+    }
+
+public:
+    AntiAliasCanvas(GCanvas* canvas) : fCanvas(canvas) {}
+
+    void save() override { fCanvas->save(); }
+    void restore() override { fCanvas->restore(); }
+    void concat(const GMatrix& m) override { fCanvas->concat(m); }
+    void flush() override { fCanvas->flush(); }
+    void drawPaint(const GPaint& p) override { fCanvas->drawPaint(aa(p)); }
+    void drawRect(const GRect& r, const GPaint& p) override { fCanvas->drawRect(r, aa(p)); }
+    void drawConvexPolygon(const GPoint pts[], int count, const GPaint& p) override {
+        fCanvas->drawConvexPolygon(pts, count, aa(p));
+    }
+    void drawPath(const GPath& path, const GPaint& p) override { fCanvas->drawPath(path, aa(p)); }
+    void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count,
+                  const int indices[], const GPaint& p) override {
+        fCanvas->drawMesh(verts, colors, texs, count, indices, aa(p));
+    }
+    void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level,
+                  const GPaint& p) override {
+        fCanvas->drawQuad(verts, colors, texs, level, aa(p));
+    }
+};
+
+/*
+ *  Runs another bench with anti-aliased paints, to compare against its aliased timing.
+ */
+class AntiAliasBench : public GBenchmark {
+    std::unique_ptr<GBenchmark> fBench;
+    const char* fName;
+public:
+    AntiAliasBench(GBenchmark* bench, const char* name) : fBench(bench), fName(name) {}
+
+    const char* name() const override { return fName; }
+    GISize size() const override { return fBench->size(); }
+    void draw(GCanvas* canvas) override {
+        AntiAliasCanvas aaCanvas(canvas);
+        fBench->draw(&aaCanvas);
+    }
+};
+
 const GBenchmark::Factory gBenchFactories[] {
     []() -> GBenchmark* { return new RectsBench(false); },
     []() -> GBenchmark* { return new RectsBench(true);  },
@@ -121,6 +360,25 @@ const GBenchmark::Factory gBenchFactories[] {
     []() -> GBenchmark* {
         return new PathBench2({256, 256}, 1024, "path_clipped");
     },
+    []() -> GBenchmark* { return new LionBench(1.2f, "path_lion"); },
+    []() -> GBenchmark* { return new LionBench(4.0f, "path_lion_zoom"); },
+    []() -> GBenchmark* { return new LionBench(5.0f, "path_lion_4k", { 3840, 2160 }); },
+    []() -> GBenchmark* { return new CurveZoomBench(1.0f, "path_curves"); },
+    []() -> GBenchmark* { return new CurveZoomBench(16.0f, "path_curves_zoom"); },
+
+    // anti-aliased coverage
+    []() -> GBenchmark* { return new AntiAliasBench(new RectsBench(false), "rects_blend_aa"); },
+    []() -> GBenchmark* { return new AntiAliasBench(new CirclesBench(false), "circles_large_aa"); },
+    []() -> GBenchmark* {
+        return new AntiAliasBench(new PathBench("path_big", 1.0f, false), "path_big_aa");
+    },
+    []() -> GBenchmark* {
+        return new AntiAliasBench(new PathBench2({256, 256}, 256, "path_unclipped"),
+                                  "path_unclipped_aa");
+    },
+    []() -> GBenchmark* {
+        return new AntiAliasBench(new LionBench(1.2f, "path_lion"), "path_lion_aa");
+    },
     []() -> GBenchmark* {
         const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }};
         return new GradientBench(colors, 2, "gradient_2_repeat", GShader::kRepeat);
@@ -130,11 +388,37 @@ const GBenchmark::Factory gBenchFactories[] {
         return new GradientBench(colors, 2, "gradient_2_mirror", GShader::kMirror);
     },
 
+    // gradient shapes other than linear, centered on the 200x200 canvas
+    []() -> GBenchmark* {
+        const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }};
+        return new GradientShapeBench(GCreateRadialGradient({100, 100}, {200, 100}, colors, 2, GShader::kClamp),
+                                      "gradient_radial");
+    },
+    []() -> GBenchmark* {
+        const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }};
+        return new GradientShapeBench(GCreateRayGradient({100, 100}, {200, 100}, colors, 2, GShader::kClamp),
+                                      "gradient_rays");
+    },
+    []() -> GBenchmark* {
+        const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }};
+        return new GradientShapeBench(GCreateFinalRadialGradient({100, 100}, 30, colors, 2, GShader::kMirror),
+                                      "gradient_final_radial_mirror");
+    },
+
     // extra benches for tiling bitmaps
     []() -> GBenchmark* { return new BitmapBench("apps/spock.png", "bitmap_repeat",
                                                  GShader::kRepeat); },
     []() -> GBenchmark* { return new BitmapBench("apps/spock.png", "bitmap_mirror",
                                                  GShader::kMirror); },
+    []() -> GBenchmark* { return new BilerpBench("apps/spock.png", "bitmap_bilerp"); },
+    []() -> GBenchmark* { return new BilerpBench("apps/spock.png", "bitmap_bilerp_mirror",
+                                                 GShader::kMirror); },
+    []() -> GBenchmark* { return new DownscaleBench(4, false, "bitmap_downscale_4x"); },
+    []() -> GBenchmark* { return new DownscaleBench(16, false, "bitmap_downscale_16x"); },
+    []() -> GBenchmark* { return new DownscaleBench(64, false, "bitmap_downscale_64x"); },
+    []() -> GBenchmark* {
+        return new DownscaleBench(16, true, "bitmap_downscale_16x_trilinear");
+    },
 
     // pa6
     []() -> GBenchmark* {
@@ -154,6 +438,39 @@ const GBenchmark::Factory gBenchFactories[] {
         const int indices[] = { 0, 1, 2,  2, 3, 0 };
         return new MeshBench(verts, colors, verts, 2, indices, "mesh_both");
      },
+    []() -> GBenchmark* { return make_grid_mesh(8, true, false, "mesh_colors_128"); },
+    []() -> GBenchmark* { return make_grid_mesh(32, true, false, "mesh_colors_2k"); },
+    []() -> GBenchmark* { return make_grid_mesh(128, true, false, "mesh_colors_32k"); },
+    []() -> GBenchmark* { return make_grid_mesh(32, false, true, "mesh_texs_2k"); },
+    []() -> GBenchmark* { return make_grid_mesh(32, true, true, "mesh_both_2k"); },
+    []() -> GBenchmark* { return new QuadBench(8, "quad_level_8"); },
+    []() -> GBenchmark* { return new QuadBench(128, "quad_level_128"); },
+
+    // span blending, one blend mode at a time
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kClear, false); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kClear, true);  },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrc, false); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrc, true);  },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDst, false); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDst, true);  },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrcOver, false); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrcOver, true);  },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDstOver, false); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDstOver, true);  },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrcIn, false); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrcIn, true);  },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDstIn, false); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDstIn, true);  },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrcOut, false); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrcOut, true);  },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDstOut, false); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDstOut, true);  },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrcATop, false); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrcATop, true);  },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDstATop, false); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDstATop, true);  },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kXor, false); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kXor, true);  },
 
     nullptr,
 };
@@ -0,0 +1,665 @@
+/**
+ *  Tests for the rasterizer's fill modes.
+ */
+
+#include "GCanvas.h"
+#include "GPath.h"
+#include "GShader.h"
+#include "GFinal.h"
+#include "GMatrix.h"
+#include "tests.h"
+#include "GRandom.h"
+#include "../BlendSpans.h"
+#include "../Blitter.h"
+#include "../GradientFunctions.h"
+#include "../MipMap.h"
+#include "../AdvancedCanvas.h"
+#include "../AdvancedShaders.h"
+#include "../ComposedShader.h"
+
+static void test_aa_rect_coverage(GTestStats* stats) {
+    GSurface surface(4, 4);
+    GCanvas* canvas = surface.canvas();
+    canvas->clear({0, 0, 0, 0});
+
+    GPaint paint(GColor::RGBA(1, 1, 1, 1));
+    paint.setAntiAlias(true);
+    canvas->drawRect(GRect::MakeLTRB(0.5f, 0.5f, 2.5f, 2.5f), paint);
+
+    const int expected[4][4] = {
+        {  64, 128,  64, 0 },
+        { 128, 255, 128, 0 },
+        {  64, 128,  64, 0 },
+        {   0,   0,   0, 0 },
+    };
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            EXPECT_EQ(stats, GPixel_GetA(*surface.bitmap().getAddr(x, y)), expected[y][x]);
+        }
+    }
+}
+
+static int count_covered(const GBitmap& bitmap) {
+    int covered = 0;
+    for (int y = 0; y < bitmap.height(); ++y) {
+        for (int x = 0; x < bitmap.width(); ++x) {
+            covered += GPixel_GetA(*bitmap.getAddr(x, y)) != 0;
+        }
+    }
+    return covered;
+}
+
+static void test_rect_fast_path_coverage(GTestStats* stats) {
+    // An axis-aligned rect is filled directly, a rotated one as a polygon; past the edges of the
+    // canvas both cover every pixel.
+    GPaint paint(GColor::RGBA(1, 1, 1, 1));
+    const float angles[] = { 0, 1e-4f };
+    for (float angle : angles) {
+        GSurface surface(10, 10);
+        GCanvas* canvas = surface.canvas();
+        canvas->clear({0, 0, 0, 0});
+        canvas->rotate(angle);
+        canvas->drawRect(GRect::MakeLTRB(0, 0, 20, 20), paint);
+        EXPECT_EQ(stats, count_covered(surface.bitmap()), 100);
+    }
+}
+
+static int count_covered_row(const GBitmap& bitmap, int y) {
+    int covered = 0;
+    for (int x = 0; x < bitmap.width(); ++x) {
+        covered += GPixel_GetA(*bitmap.getAddr(x, y)) != 0;
+    }
+    return covered;
+}
+
+static void test_near_horizontal_edges(GTestStats* stats) {
+    // The top edges climb 0.0002 of a row across the canvas, far flatter than 16.16 can step,
+    // and cross the center of row 10 halfway along.
+    GPaint paint(GColor::RGBA(1, 1, 1, 1));
+    GPoint poly[] = { {0, 10.4999f}, {100, 10.5001f}, {100, 30}, {0, 30} };
+    GSurface surface(100, 40);
+    surface.canvas()->clear({0, 0, 0, 0});
+    surface.canvas()->drawConvexPolygon(poly, 4, paint);
+    EXPECT_EQ(stats, count_covered_row(surface.bitmap(), 9), 0);
+    EXPECT_EQ(stats, count_covered_row(surface.bitmap(), 10), 50);
+    EXPECT_EQ(stats, count_covered_row(surface.bitmap(), 11), 100);
+
+    GPoint tri[] = { {0, 10.4999f}, {100, 10.5001f}, {0, 30} };
+    const int indices[] = { 0, 1, 2 };
+    const GColor colors[] = { {1, 1, 1, 1}, {1, 1, 1, 1}, {1, 1, 1, 1} };
+    surface.canvas()->clear({0, 0, 0, 0});
+    surface.canvas()->drawMesh(tri, colors, nullptr, 1, indices, paint);
+    EXPECT_EQ(stats, count_covered_row(surface.bitmap(), 9), 0);
+    EXPECT_EQ(stats, count_covered_row(surface.bitmap(), 10), 50);
+}
+
+static void test_aa_path_winding(GTestStats* stats) {
+    GSurface surface(8, 8);
+    GCanvas* canvas = surface.canvas();
+    canvas->clear({0, 0, 0, 0});
+
+    // two overlapping squares wound the same way still cover each pixel exactly once
+    GPath path;
+    path.addRect(GRect::MakeLTRB(0, 0, 6, 6));
+    path.addRect(GRect::MakeLTRB(2, 2, 8, 8));
+
+    GPaint paint(GColor::RGBA(1, 1, 1, 1));
+    paint.setAntiAlias(true);
+    canvas->drawPath(path, paint);
+
+    EXPECT_EQ(stats, *surface.bitmap().getAddr(0, 0), (GPixel)0xFFFFFFFF);
+    EXPECT_EQ(stats, *surface.bitmap().getAddr(3, 3), (GPixel)0xFFFFFFFF);
+    EXPECT_EQ(stats, *surface.bitmap().getAddr(7, 7), (GPixel)0xFFFFFFFF);
+    EXPECT_EQ(stats, *surface.bitmap().getAddr(7, 0), (GPixel)0);
+    EXPECT_EQ(stats, *surface.bitmap().getAddr(0, 7), (GPixel)0);
+}
+
+static void test_mesh_shared_edges(GTestStats* stats) {
+    GSurface surface(16, 16);
+    GCanvas* canvas = surface.canvas();
+    canvas->clear({0, 0, 0, 0});
+
+    // a finely tessellated, half transparent quad still blends each pixel exactly once
+    const GPoint verts[] = { {0, 0}, {16, 0}, {16, 16}, {0, 16} };
+    const GColor colors[] = { {1, 1, 1, 0.5f}, {1, 1, 1, 0.5f}, {1, 1, 1, 0.5f}, {1, 1, 1, 0.5f} };
+    canvas->drawQuad(verts, colors, nullptr, 100, GPaint());
+
+    for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < 16; ++x) {
+            EXPECT_EQ(stats, GPixel_GetA(*surface.bitmap().getAddr(x, y)), 128);
+        }
+    }
+}
+
+static GPixel rand_premul_pixel(GRandom& rand) {
+    // weight the ends, where the blend formulas have their edge cases
+    int a = rand.nextRange(0, 3) == 0 ? rand.nextRange(0, 1) * 255 : rand.nextRange(0, 255);
+    return GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a), rand.nextRange(0, a));
+}
+
+static void test_blend_spans_exact(GTestStats* stats) {
+    const int N = 37;   // covers whole vectors and a leftover tail
+    GRandom rand;
+    for (int opaque = 0; opaque < 2; ++opaque) {
+        for (int m = 0; m < 12; ++m) {
+            GBlendMode mode = static_cast<GBlendMode>(m);
+            const BlendSpanProcs& procs = getBlendSpanProcs(mode, opaque);
+
+            int mismatches = 0;
+            for (int trial = 0; trial < 50; ++trial) {
+                GPixel src[N], dst[N], span[N], solid[N];
+                for (int i = 0; i < N; ++i) {
+                    src[i] = rand_premul_pixel(rand);
+                    if (opaque) {
+                        src[i] |= GPixel_PackARGB(255, 0, 0, 0);
+                    }
+                    dst[i] = span[i] = solid[i] = rand_premul_pixel(rand);
+                }
+                procs.span(src, span, N);
+                procs.solidSpan(src[0], solid, N);
+
+                for (int i = 0; i < N; ++i) {
+                    GPixel expected = dst[i];
+                    procs.pixel(src[i], expected);
+                    mismatches += span[i] != expected;
+
+                    expected = dst[i];
+                    procs.pixel(src[0], expected);
+                    mismatches += solid[i] != expected;
+                }
+            }
+            EXPECT_EQ(stats, mismatches, 0);
+        }
+    }
+}
+
+static void test_shader_opacity(GTestStats* stats) {
+    const GColor opaque[] = { {1, 0, 0, 1}, {0, 0, 1, 1} };
+    const GColor translucent[] = { {1, 0, 0, 1}, {0, 0, 1, 0.5f} };
+    EXPECT_TRUE(stats, GCreateLinearGradient({0, 0}, {10, 0}, opaque, 2)->isOpaque());
+    EXPECT_FALSE(stats, GCreateLinearGradient({0, 0}, {10, 0}, translucent, 2)->isOpaque());
+
+    GBitmap bitmap;
+    bitmap.alloc(2, 2);
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 2; ++x) {
+            *bitmap.getAddr(x, y) = GPixel_PackARGB(255, 10, 20, 30);
+        }
+    }
+    EXPECT_TRUE(stats, GCreateBitmapShader(bitmap, GMatrix())->isOpaque());
+    *bitmap.getAddr(1, 1) = GPixel_PackARGB(128, 10, 10, 10);
+    EXPECT_FALSE(stats, GCreateBitmapShader(bitmap, GMatrix())->isOpaque());
+    free(bitmap.pixels());
+}
+
+static int tile_column(int i, int size, GShader::TileMode mode) {
+    switch (mode) {
+        case GShader::kRepeat:
+            return ((i % size) + size) % size;
+        case GShader::kMirror: {
+            int m = ((i % (2 * size)) + 2 * size) % (2 * size);
+            return m < size ? m : 2 * size - 1 - m;
+        }
+        default:
+            return std::max(0, std::min(i, size - 1));
+    }
+}
+
+// Shades count pixels of row y from x as one span, and again as spans of 1, 2, 3... pixels, and
+// returns whether every pixel came out the same both ways.
+static bool shades_split_spans_alike(GShader* shader, int x, int y, int count) {
+    GPixel whole[256];
+    GPixel split[256];
+    count = std::min(count, 256);
+    shader->shadeRow(x, y, count, whole);
+    int n = 1;
+    for (int start = 0; start < count; start += n++) {
+        shader->shadeRow(x + start, y, std::min(n, count - start), split + start);
+    }
+    return std::equal(whole, whole + count, split);
+}
+
+static void test_bitmap_shader_paths(GTestStats* stats) {
+    // Each pixel's red is its column, so a shaded row spells out which columns it sampled.
+    GBitmap bitmap;
+    bitmap.alloc(4, 2);
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            *bitmap.getAddr(x, y) = GPixel_PackARGB(255, x, y, 0);
+        }
+    }
+
+    const GShader::TileMode modes[] = { GShader::kClamp, GShader::kRepeat, GShader::kMirror };
+    // A whole pixel shift, then a scale with a shift, each sampled at u = (x + 0.5 - tx) / sx.
+    const float scales[] = { 1, 2 };
+    const float shifts[] = { 6, -3 };
+    GPixel row[40];
+    for (GShader::TileMode mode : modes) {
+        for (int k = 0; k < 2; ++k) {
+            GMatrix local = GMatrix::Concat(GMatrix::Translate(shifts[k], 0), GMatrix::Scale(scales[k], 1));
+            auto shader = GCreateBitmapShader(bitmap, local, mode);
+            EXPECT_TRUE(stats, shader->setContext(GMatrix()));
+            shader->shadeRow(-10, 0, 40, row);
+            bool matches = true;
+            for (int i = 0; i < 40; ++i) {
+                int column = tile_column((int) std::floor((i - 10 + 0.5f - shifts[k]) / scales[k]), 4, mode);
+                matches &= row[i] == GPixel_PackARGB(255, column, 0, 0);
+            }
+            EXPECT_TRUE(stats, matches);
+        }
+
+        // A pixel samples the same texel whichever span it is shaded in.
+        auto scaled = GCreateBitmapShader(bitmap, GMatrix::Scale(2.7f, 1), mode);
+        bool alike = true;
+        for (int k = 0; k < 16; ++k) {
+            alike &= scaled->setContext(GMatrix::Translate(k * 0.173f, 0))
+                  && shades_split_spans_alike(scaled.get(), 3000, 0, 256);
+        }
+        EXPECT_TRUE(stats, alike);
+    }
+    free(bitmap.pixels());
+}
+
+static void test_bilerp_shader(GTestStats* stats) {
+    GBitmap bitmap;
+    bitmap.alloc(2, 1);
+    *bitmap.getAddr(0, 0) = GPixel_PackARGB(255, 0, 0, 0);
+    *bitmap.getAddr(1, 0) = GPixel_PackARGB(255, 200, 100, 40);
+    auto final = GCreateFinal();
+    GPixel row[4];
+
+    // Sampling pixel centers gives back the pixels themselves.
+    auto identity = final->createBilerpShader(bitmap, GMatrix());
+    EXPECT_TRUE(stats, identity->setContext(GMatrix()));
+    identity->shadeRow(0, 0, 2, row);
+    EXPECT_EQ(stats, row[0], *bitmap.getAddr(0, 0));
+    EXPECT_EQ(stats, row[1], *bitmap.getAddr(1, 0));
+
+    // Doubled, the samples fall a quarter and three quarters of the way between the centers,
+    // and clamp to the edge pixels outside them.
+    auto doubled = final->createBilerpShader(bitmap, GMatrix::Scale(2, 1));
+    EXPECT_TRUE(stats, doubled->setContext(GMatrix()));
+    doubled->shadeRow(0, 0, 4, row);
+    EXPECT_EQ(stats, row[0], *bitmap.getAddr(0, 0));
+    EXPECT_EQ(stats, row[1], GPixel_PackARGB(255, 50, 25, 10));
+    EXPECT_EQ(stats, row[2], GPixel_PackARGB(255, 150, 75, 30));
+    EXPECT_EQ(stats, row[3], *bitmap.getAddr(1, 0));
+
+    // A pixel gets the same pixels and weights whichever span it is shaded in.
+    auto scaled = GCreateBilerpShader(bitmap, GMatrix::Scale(2.7f, 1), GShader::kRepeat, MipMap::kNone);
+    bool alike = true;
+    for (int k = 0; k < 16; ++k) {
+        alike &= scaled->setContext(GMatrix::Translate(k * 0.173f, 0))
+              && shades_split_spans_alike(scaled.get(), 3000, 0, 256);
+    }
+    EXPECT_TRUE(stats, alike);
+    free(bitmap.pixels());
+}
+
+static void test_bitmap_mipmaps(GTestStats* stats) {
+    // A checkerboard of single black and white pixels averages to gray a level down.
+    GBitmap bitmap;
+    bitmap.alloc(5, 4);
+    for (int y = 0; y < bitmap.height(); ++y) {
+        for (int x = 0; x < bitmap.width(); ++x) {
+            int v = ((x + y) & 1) ? 255 : 0;
+            *bitmap.getAddr(x, y) = GPixel_PackARGB(255, v, v, v);
+        }
+    }
+
+    MipMap mipmap(bitmap);
+    EXPECT_EQ(stats, mipmap.levelCount(), 3);
+    GBitmap half = mipmap.level(1);
+    EXPECT_EQ(stats, half.width(), 2);
+    EXPECT_EQ(stats, half.height(), 2);
+    EXPECT_EQ(stats, *half.getAddr(1, 1), GPixel_PackARGB(255, 128, 128, 128));
+    EXPECT_EQ(stats, mipmap.level(2).width(), 1);
+
+    // Drawn at half size, the nearest shader samples that level instead of picking black or white.
+    auto shader = GCreateBitmapShader(bitmap, GMatrix::Scale(0.5f, 0.5f));
+    EXPECT_TRUE(stats, shader->setContext(GMatrix()));
+    GPixel row[2];
+    shader->shadeRow(0, 1, 2, row);
+    EXPECT_EQ(stats, row[0], GPixel_PackARGB(255, 128, 128, 128));
+    EXPECT_EQ(stats, row[1], GPixel_PackARGB(255, 128, 128, 128));
+    free(bitmap.pixels());
+
+    // Odd sides fold their last column and row into the last texel along them, rather than
+    // dropping them. Here only that column and row are red.
+    bitmap.alloc(5, 3);
+    for (int y = 0; y < bitmap.height(); ++y) {
+        for (int x = 0; x < bitmap.width(); ++x) {
+            int v = (x == 4 || y == 2) ? 255 : 0;
+            *bitmap.getAddr(x, y) = GPixel_PackARGB(255, v, 0, 0);
+        }
+    }
+    MipMap odd(bitmap);
+    half = odd.level(1);
+    EXPECT_EQ(stats, half.width(), 2);
+    EXPECT_EQ(stats, half.height(), 1);
+    EXPECT_EQ(stats, *half.getAddr(0, 0), GPixel_PackARGB(255, 85, 0, 0));
+    EXPECT_EQ(stats, *half.getAddr(1, 0), GPixel_PackARGB(255, 142, 0, 0));
+    EXPECT_EQ(stats, *odd.level(2).getAddr(0, 0), GPixel_PackARGB(255, 114, 0, 0));
+    free(bitmap.pixels());
+}
+
+static void test_tri_color_stepping(GTestStats* stats) {
+    GPoint points[] = { {0, 0}, {100, 0}, {0, 100} };
+    GColor colors[] = { {1, 0, 0, 1}, {0, 0.5f, 0, 0.5f}, {0, 0, 1, 1} };
+    auto shader = GCreateTriColorShader(points, colors);
+    EXPECT_TRUE(stats, shader->setContext(GMatrix()));
+
+    // The center of pixel (50, 0) is a little over halfway along the top edge.
+    GPixel row[300];
+    shader->shadeRow(-100, 0, 300, row);
+    GPixel mid = row[150];
+    EXPECT_TRUE(stats, std::abs(GPixel_GetA(mid) - 191) <= 1);
+    EXPECT_TRUE(stats, std::abs(GPixel_GetR(mid) - 125) <= 1);
+    EXPECT_TRUE(stats, std::abs(GPixel_GetG(mid) - 64) <= 1);
+
+    // Far past the corners the plane leaves 0..255, but pixels stay premultiplied.
+    bool premultiplied = true;
+    for (int i = 0; i < 300; ++i) {
+        int a = GPixel_GetA(row[i]);
+        premultiplied &= GPixel_GetR(row[i]) <= a && GPixel_GetG(row[i]) <= a && GPixel_GetB(row[i]) <= a;
+    }
+    EXPECT_TRUE(stats, premultiplied);
+
+    // A pixel gets the same color whichever span it is shaded in.
+    GPoint skewed[] = { {3.3f, 1.7f}, {211.9f, 40.2f}, {25.1f, 187.6f} };
+    GColor shades[] = { {0.9f, 0.3f, 0.2f, 1}, {0.1f, 0.7f, 0.05f, 0.8f}, {0.2f, 0.1f, 0.6f, 0.7f} };
+    auto skewedShader = GCreateTriColorShader(skewed, shades);
+    EXPECT_TRUE(stats, skewedShader->setContext(GMatrix::Scale(1.3f, 1.1f)));
+    bool alike = true;
+    for (int y = 0; y < 200; y += 7) {
+        alike &= shades_split_spans_alike(skewedShader.get(), 0, y, 256);
+    }
+    EXPECT_TRUE(stats, alike);
+}
+
+static void test_textured_color_fusion(GTestStats* stats) {
+    GBitmap bitmap;
+    bitmap.alloc(8, 8);
+    GRandom rand;
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            *bitmap.getAddr(x, y) = rand_premul_pixel(rand);
+        }
+    }
+    auto texture = GCreateBitmapShader(bitmap, GMatrix(), GShader::kRepeat);
+
+    GPoint points[] = { {0, 0}, {40, 4}, {6, 30} };
+    GPoint texs[] = { {0, 0}, {8, 0}, {0, 8} };
+    GColor colors[] = { {1, 0.5f, 0, 1}, {0, 0.25f, 0.25f, 0.5f}, {0.1f, 0.1f, 0.1f, 0.2f} };
+    TriBitmapShader textureShader(texture.get());
+    TriColorShader colorShader;
+    textureShader.setTriangle(points, texs);
+    colorShader.setTriangle(points, colors);
+
+    // The fused path multiplies exactly as the general composition does.
+    ComposedShader composed(&textureShader, &colorShader);
+    TexturedColorShader fused(&textureShader, &colorShader);
+    GPixel expected[100];
+    GPixel actual[100];
+    bool same = true;
+    for (int y = 0; y < 30; y += 3) {
+        EXPECT_TRUE(stats, composed.setContext(GMatrix()));
+        composed.shadeRow(-20, y, 100, expected);
+        EXPECT_TRUE(stats, fused.setContext(GMatrix()));
+        fused.shadeRow(-20, y, 100, actual);
+        same &= std::equal(expected, expected + 100, actual);
+    }
+    EXPECT_TRUE(stats, same);
+    free(bitmap.pixels());
+}
+
+// Draws a mesh, paths and rects across the whole canvas in several blend modes, with and without
+// antialiasing and shaders, for comparing canvases that split their work differently.
+static void draw_split_scene(GCanvas* canvas, const GBitmap& texture) {
+    canvas->clear({0.2f, 0.3f, 0.4f, 1});
+
+    const int kCells = 6;
+    GPoint verts[(kCells + 1) * (kCells + 1)];
+    GColor colors[(kCells + 1) * (kCells + 1)];
+    GPoint texs[(kCells + 1) * (kCells + 1)];
+    GRandom rand;
+    for (int y = 0; y <= kCells; ++y) {
+        for (int x = 0; x <= kCells; ++x) {
+            int i = y * (kCells + 1) + x;
+            verts[i] = { x * 97.3f + rand.nextF() * 20, y * 83.9f + rand.nextF() * 20 };
+            colors[i] = { rand.nextF(), rand.nextF(), rand.nextF(), 0.5f + rand.nextF() * 0.5f };
+            texs[i] = { x * 5.0f, y * 5.0f };
+        }
+    }
+    int indices[kCells * kCells * 6];
+    int n = 0;
+    for (int y = 0; y < kCells; ++y) {
+        for (int x = 0; x < kCells; ++x) {
+            int i = y * (kCells + 1) + x;
+            const int corners[] = { i, i + 1, i + kCells + 1, i + 1, i + kCells + 2, i + kCells + 1 };
+            std::copy(corners, corners + 6, indices + n);
+            n += 6;
+        }
+    }
+    canvas->drawMesh(verts, colors, nullptr, kCells * kCells * 2, indices, GPaint());
+
+    auto shader = GCreateBitmapShader(texture, GMatrix::Scale(0.37f, 0.37f), GShader::kRepeat);
+    GPaint textured(shader.get());
+    textured.setBlendMode(GBlendMode::kSrcATop);
+    canvas->drawMesh(verts, colors, texs, kCells * kCells * 2, indices, textured);
+
+    const GBlendMode modes[] = { GBlendMode::kSrcOver, GBlendMode::kDstOver, GBlendMode::kSrcIn,
+                                 GBlendMode::kDstOut, GBlendMode::kXor, GBlendMode::kSrc };
+    const GColor gradientColors[] = { {1, 0, 0, 0.8f}, {0, 1, 0, 0.3f}, {0, 0, 1, 1} };
+    auto gradient = GCreateLinearGradient({30, 40}, {550, 470}, gradientColors, 3, GShader::kMirror);
+    for (int k = 0; k < 6; ++k) {
+        GPaint paint(GColor::RGBA(0.9f, 0.6f - k * 0.1f, 0.1f * k, 0.4f + k * 0.1f));
+        paint.setBlendMode(modes[k]);
+        paint.setAntiAlias(k & 1);
+        if (k % 3 == 2) {
+            paint.setShader(gradient.get());
+        }
+
+        canvas->save();
+        canvas->translate(k * 90.0f, k * 70.0f);
+        canvas->rotate(k * 0.4f);
+        canvas->drawRect(GRect::MakeLTRB(-40, -30, 230, 150), paint);
+        canvas->restore();
+
+        GPath path;
+        path.moveTo(20 + k * 100, 500);
+        path.cubicTo(300, -100 + k * 40, 50, 300, 590 - k * 50, 20 + k * 80);
+        path.quadTo(400, 510, 20 + k * 100, 500);
+        path.addCircle({300, 260}, 60 + k * 30, k & 1 ? GPath::kCW_Direction : GPath::kCCW_Direction);
+        canvas->drawPath(path, paint);
+    }
+}
+
+static void test_clipped_polygon_rows(GTestStats* stats) {
+    // Several of the hexagon's edges end above each clip, so the rows start partway down the list.
+    const GPoint hexagon[] = { {50, 3.3f}, {88, 20}, {91, 64.7f}, {47, 96}, {9, 70}, {12, 25.5f} };
+    GPaint paint(GColor::RGBA(0.8f, 0.4f, 0.2f, 0.7f));
+
+    GBitmap plain;
+    GBitmap clipped;
+    plain.alloc(100, 100);
+    clipped.alloc(100, 100);
+    auto canvas = GCreateCanvas(plain);
+    canvas->clear({0, 0, 0, 0});
+    canvas->drawConvexPolygon(hexagon, 6, paint);
+
+    const int clipTops[] = { 0, 21, 40, 66, 95 };
+    int diffs = 0;
+    for (int top: clipTops) {
+        GIRect clip = GIRect::MakeLTRB(5, top, 97, 100);
+        auto clippedCanvas = GCreateClippedCanvas(clipped, clip);
+        clippedCanvas->clear({0, 0, 0, 0});
+        clippedCanvas->drawConvexPolygon(hexagon, 6, paint);
+        for (int y = clip.top(); y < clip.bottom(); ++y) {
+            for (int x = clip.left(); x < clip.right(); ++x) {
+                diffs += *clipped.getAddr(x, y) != *plain.getAddr(x, y);
+            }
+        }
+    }
+    EXPECT_EQ(stats, diffs, 0);
+
+    free(plain.pixels());
+    free(clipped.pixels());
+}
+
+static void test_split_canvases_alike(GTestStats* stats) {
+    GBitmap texture;
+    texture.alloc(16, 16);
+    GRandom rand;
+    for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < 16; ++x) {
+            *texture.getAddr(x, y) = rand_premul_pixel(rand);
+        }
+    }
+
+    // Larger than one tile or one band, so the scene is split between threads.
+    GBitmap plain;
+    GBitmap banded;
+    GBitmap tiled;
+    plain.alloc(600, 520);
+    banded.alloc(600, 520);
+    tiled.alloc(600, 520);
+    draw_split_scene(GCreateCanvas(plain).get(), texture);
+    draw_split_scene(GCreateBandedCanvas(banded, 4).get(), texture);
+    draw_split_scene(GCreateTiledCanvas(tiled, 4).get(), texture);
+
+    int bandedDiffs = 0;
+    int tiledDiffs = 0;
+    for (int y = 0; y < plain.height(); ++y) {
+        for (int x = 0; x < plain.width(); ++x) {
+            bandedDiffs += *banded.getAddr(x, y) != *plain.getAddr(x, y);
+            tiledDiffs += *tiled.getAddr(x, y) != *plain.getAddr(x, y);
+        }
+    }
+    EXPECT_EQ(stats, bandedDiffs, 0);
+    EXPECT_EQ(stats, tiledDiffs, 0);
+
+    free(texture.pixels());
+    free(plain.pixels());
+    free(banded.pixels());
+    free(tiled.pixels());
+}
+
+static void test_gradient_tiling(GTestStats* stats) {
+    const GColor colors[] = { {1, 0, 0, 1}, {0, 0, 1, 0.5f} };
+    GPixel row[30];
+
+    // Clamped past either end is exactly the end color.
+    auto clamp = GCreateLinearGradient({10, 0}, {20, 0}, colors, 2, GShader::kClamp);
+    clamp->setContext(GMatrix());
+    clamp->shadeRow(0, 0, 30, row);
+    EXPECT_EQ(stats, row[0], GPixel_PackARGB(255, 255, 0, 0));
+    EXPECT_EQ(stats, row[29], GPixel_PackARGB(128, 0, 0, 128));
+
+    // Mirrored t = 1.55 reflects back to t = 0.45.
+    auto mirror = GCreateLinearGradient({0, 0}, {10, 0}, colors, 2, GShader::kMirror);
+    mirror->setContext(GMatrix());
+    mirror->shadeRow(0, 0, 30, row);
+    EXPECT_EQ(stats, row[15], row[4]);
+    EXPECT_EQ(stats, row[25], row[14]);
+
+    auto repeat = GCreateLinearGradient({0, 0}, {10, 0}, colors, 2, GShader::kRepeat);
+    repeat->setContext(GMatrix());
+    repeat->shadeRow(0, 0, 30, row);
+    EXPECT_EQ(stats, row[13], row[3]);
+    EXPECT_EQ(stats, row[27], row[7]);
+}
+
+static void test_gradient_kernels(GTestStats* stats) {
+    GRandom rand;
+    int far = 0;
+    int lanesOff = 0;
+    for (int trial = 0; trial < 1000; ++trial) {
+        float x[4], y[4], t[4];
+        for (int k = 0; k < 4; ++k) {
+            // include the axes and both signed zeros, where atan2 changes quadrant
+            x[k] = rand.nextRange(0, 7) == 0 ? (rand.nextRange(0, 1) ? 0.0f : -0.0f) : rand.nextF() * 8 - 4;
+            y[k] = rand.nextRange(0, 7) == 0 ? (rand.nextRange(0, 1) ? 0.0f : -0.0f) : rand.nextF() * 8 - 4;
+            t[k] = RayGradientMap::map(x[k], y[k]);
+            far += std::abs(t[k] - (float) ((std::atan2(x[k], y[k]) + M_PI) / (2 * M_PI))) > 1e-5f;
+        }
+#if defined(__SSE2__)
+        float lanes[4];
+        _mm_storeu_ps(lanes, RayGradientMap::map(_mm_loadu_ps(x), _mm_loadu_ps(y)));
+        _mm_storeu_ps(x, _mm_mul_ps(_mm_loadu_ps(x), _mm_set1_ps(500)));
+        int clamp[4], repeat[4], mirror[4];
+        _mm_storeu_si128((__m128i*) clamp, GradientLUT::index<GShader::kClamp>(_mm_loadu_ps(x)));
+        _mm_storeu_si128((__m128i*) repeat, GradientLUT::index<GShader::kRepeat>(_mm_loadu_ps(x)));
+        _mm_storeu_si128((__m128i*) mirror, GradientLUT::index<GShader::kMirror>(_mm_loadu_ps(x)));
+        for (int k = 0; k < 4; ++k) {
+            lanesOff += lanes[k] != t[k];
+            lanesOff += clamp[k] != GradientLUT::index<GShader::kClamp>(x[k]);
+            lanesOff += repeat[k] != GradientLUT::index<GShader::kRepeat>(x[k]);
+            lanesOff += mirror[k] != GradientLUT::index<GShader::kMirror>(x[k]);
+        }
+#endif
+    }
+    EXPECT_EQ(stats, far, 0);
+    EXPECT_EQ(stats, lanesOff, 0);
+}
+
+static void test_blitter_runs(GTestStats* stats) {
+    const int W = 13;
+    const uint8_t alpha[] = { 255, 0, 90, 255, 0, 1 };
+    const int runs[]      = {   3, 2,  1,   4, 1, 2 };
+    const int runCount = 6;
+    uint8_t mask[W];
+    for (int i = 0, x = 0; i < runCount; ++i) {
+        for (int k = 0; k < runs[i]; ++k) {
+            mask[x++] = alpha[i];
+        }
+    }
+
+    const GColor colors[] = { {1, 0, 0, 1}, {0, 0, 1, 0.5f} };
+    auto gradient = GCreateLinearGradient({0, 0}, {W, 0}, colors, 2);
+    gradient->setContext(GMatrix());
+    const BlendSpanProcs& procs = getBlendSpanProcs(GBlendMode::kSrcOver);
+    GPixel shadeBuffer[W];
+
+    for (int shaded = 0; shaded < 2; ++shaded) {
+        // The same row three ways: as runs, one pixel at a time, and as a mask.
+        GBitmap bitmaps[3];
+        for (int way = 0; way < 3; ++way) {
+            bitmaps[way].alloc(W, 1);
+            GRandom rand;
+            for (int x = 0; x < W; ++x) {
+                *bitmaps[way].getAddr(x, 0) = rand_premul_pixel(rand);
+            }
+
+            SolidBlitter solidBlitter(bitmaps[way], GPixel_PackARGB(178, 36, 107, 71), procs);
+            ShaderBlitter shaderBlitter(bitmaps[way], gradient.get(), procs, shadeBuffer);
+            Blitter& blitter = shaded ? (Blitter&) shaderBlitter : (Blitter&) solidBlitter;
+
+            if (way == 0) {
+                blitter.blitAntiH(0, 0, alpha, runs, runCount);
+            } else if (way == 1) {
+                int one = 1;
+                for (int x = 0; x < W; ++x) {
+                    if (mask[x] == 255) {
+                        blitter.blitH(x, 0, 1);
+                    } else if (mask[x] > 0) {
+                        blitter.blitAntiH(x, 0, &mask[x], &one, 1);
+                    }
+                }
+            } else {
+                blitter.blitMask(GIRect::MakeWH(W, 1), mask, W);
+            }
+        }
+
+        int mismatches = 0;
+        for (int x = 0; x < W; ++x) {
+            mismatches += *bitmaps[0].getAddr(x, 0) != *bitmaps[1].getAddr(x, 0);
+            mismatches += *bitmaps[2].getAddr(x, 0) != *bitmaps[1].getAddr(x, 0);
+        }
+        EXPECT_EQ(stats, mismatches, 0);
+
+        for (GBitmap& bitmap : bitmaps) {
+            free(bitmap.pixels());
+        }
+    }
+}
@@ -32,6 +32,7 @@ private:
 #include "tests_pa3.cpp"
 #include "tests_pa4.cpp"
 #include "tests_pa5.cpp"
+#include "tests_raster.cpp"
 
 const GTestRec gTestRecs[] = {
     { test_matrix,      "matrix_setters"    },
@@ -49,6 +50,24 @@ const GTestRec gTestRecs[] = {
     { test_path_chop_quad,   "path_chop_quad"    },
     { test_path_chop_cubic,   "path_chop_cubic"    },
 
+    { test_aa_rect_coverage, "aa_rect_coverage" },
+    { test_rect_fast_path_coverage, "rect_fast_path_coverage" },
+    { test_near_horizontal_edges, "near_horizontal_edges" },
+    { test_aa_path_winding,  "aa_path_winding"  },
+    { test_mesh_shared_edges, "mesh_shared_edges" },
+    { test_blend_spans_exact, "blend_spans_exact" },
+    { test_shader_opacity,    "shader_opacity"    },
+    { test_blitter_runs,      "blitter_runs"      },
+    { test_gradient_tiling,   "gradient_tiling"   },
+    { test_gradient_kernels,  "gradient_kernels"  },
+    { test_bitmap_shader_paths, "bitmap_shader_paths" },
+    { test_bilerp_shader,     "bilerp_shader"     },
+    { test_bitmap_mipmaps,    "bitmap_mipmaps"    },
+    { test_tri_color_stepping, "tri_color_stepping" },
+    { test_textured_color_fusion, "textured_color_fusion" },
+    { test_clipped_polygon_rows, "clipped_polygon_rows" },
+    { test_split_canvases_alike, "split_canvases_alike" },
+
     { nullptr, nullptr },
 };
 
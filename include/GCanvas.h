@@ -122,6 +122,12 @@ public:
     virtual void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
                           int level, const GPaint&) = 0;
 
+    /**
+     *  Finish any drawing the canvas has deferred, so that the bitmap holds every draw made so
+     *  far. Canvases that draw immediately have nothing to do here.
+     */
+    virtual void flush() {}
+
     // Helpers
 
     void translate(float x, float y) {
@@ -153,6 +159,13 @@ public:
  */
 std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap);
 
+/**
+ *  Like GCreateCanvas, but draws are recorded and rasterized in screen tiles spread across
+ *  threadCount threads. The pixels are identical to what GCreateCanvas would produce, once
+ *  flush() has been called (or the canvas has been destroyed).
+ */
+std::unique_ptr<GCanvas> GCreateTiledCanvas(const GBitmap& bitmap, int threadCount);
+
 /**
  *  Implement this, drawing into the provided canvas, and returning the title of your artwork.
  */
@@ -34,10 +34,15 @@ public:
     GShader* getShader() const { return fShader; }
     GPaint&  setShader(GShader* s) { fShader = s; return *this; }
 
+    // When set, edges are drawn with analytic partial-pixel coverage instead of whole pixels.
+    bool    isAntiAlias() const { return fAntiAlias; }
+    GPaint& setAntiAlias(bool aa) { fAntiAlias = aa; return *this; }
+
 private:
     GColor      fColor = {0, 0, 0, 1};
     GShader*    fShader = nullptr;
     GBlendMode  fMode = GBlendMode::kSrcOver;
+    bool        fAntiAlias = false;
 };
 
 #endif
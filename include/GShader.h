@@ -32,6 +32,10 @@ public:
     // The draw calls in GCanvas must call this with the CTM before any calls to shadeSpan().
     virtual bool setContext(const GMatrix& ctm) = 0;
 
+    // Return true iff, once setContext() has returned, shadeRow() may be called from several
+    // threads at once (e.g. it only reads state set up by the constructor and setContext()).
+    virtual bool canShadeConcurrently() { return false; }
+
     /**
      *  Given a row of pixels in device space [x, y] ... [x + count - 1, y], return the
      *  corresponding src pixels in row[0...count - 1]. The caller must ensure that row[]